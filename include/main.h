@@ -1,53 +1,303 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+// Config switches (may be overridden from build_flags, see platformio.ini)
+#ifndef DEBUG
+#define DEBUG 0  // 1: DEBUG at 115200, 0: No DEBUG
+#endif
+#ifndef DHCP
+#define DHCP 1  // 1: Use DHCP, 0: Use static IP as defined in main
+#endif
+#ifndef TEST_MODE
+#define TEST_MODE 1  // 1: Just run some LEDs on Red, 0: normal behaviour
+#endif
+#ifndef INGEST_LUT
+#define INGEST_LUT 1  // 1: Gamma, colour correction and brightness applied by lookup table as pixels arrive (768 bytes of SRAM), 0: as sent
+#endif
+#ifndef UNIVERSE_OUTPUT
+#define UNIVERSE_OUTPUT 0  // 1: Each strip is one universe on its own pin, shown as soon as it arrives, 0: whole frames
+#endif
+#ifndef FRAME_SCHEDULER
+#define FRAME_SCHEDULER 1  // 1: Complete frames held back to go out on a steady cadence locked to the sender's frame rate, 0: shown as soon as complete
+#endif
+#ifndef SKIP_UNCHANGED
+#define SKIP_UNCHANGED 1  // 1: Unchanged universes aren't copied again and unchanged frames aren't shown, 0: always
+#endif
+#ifndef PIXEL_FORMAT
+#define PIXEL_FORMAT PIXEL_RGB  // what a pixel is on the wire and on the strip, see "Pixel formats" below
+#endif
+#ifndef TELEMETRY
+#define TELEMETRY 1  // 1: Counters published in the ArtPollReply NodeReport and as ArtDiagData when polled for, 0: off
+#endif
+#ifndef ZERO_COPY
+#define ZERO_COPY 1  // 1: Read ArtDmx payloads off the W5100 straight into leds[], 0: via the receive buffer
+#endif
+
+#if ZERO_COPY
+// Only packet headers are buffered, saving 512 bytes of SRAM
+#define ARTNET_RECEIVE_BUFFER_SIZE 18
+#endif
+
 #include <Arduino.h>
 #include <ArtnetEther.h>
+#include <EEPROM.h>
 #include <Ethernet.h>
 #include <EthernetUdp.h>
 #include <FastLED.h>
 #include <SPI.h>
-
-// Config switches
-#define DEBUG     0  // 1: DEBUG at 115200, 0: No DEBUG
-#define DHCP      1  // 1: Use DHCP, 0: Use static IP as defined in main
-#define TEST_MODE 1  // 1: Just run some LEDs on Red, 0: normal behaviour
+#include <Trace.h>  // TRACE and TRACE_DEPTH are set from build_flags, see lib/Trace
 
 // Pin definitions
 #define WS2812_DATA_PIN      6
 #define NETWORK_STATUS_PIN   4
 #define LED_WRITE_STATUS_PIN 3
+#define UNIVERSE_DATA_PINS   6, 7  // one per strip with UNIVERSE_OUTPUT, in universe order
+#define ETHERNET_INT_PIN     -1  // W5100/W5200/W5500 INT, on an external interrupt pin (2 on the Uno); -1 polls instead
 
 // LED Configuration
 #define NUM_LEDS              300
 #define ARTNET_PORT           6454
 #define START_UNIVERSE        0  // we may not want to begin on universe 0 (remember that artnet is 0-indexed)
-#define LEDS_PER_UNIVERSE     170
-#define CHANNELS_PER_UNIVERSE (LEDS_PER_UNIVERSE * 3)
+#define LEDS_PER_UNIVERSE     (512 / PIXEL_IN_BYTES)  // 170 RGB pixels
+#define CHANNELS_PER_UNIVERSE (LEDS_PER_UNIVERSE * PIXEL_IN_BYTES)
+#define NUM_STRIPS            1  // strips clocked out in parallel on pins 22-29 (Mega only); 1: just WS2812_DATA_PIN
+#define LEDS_PER_STRIP        (NUM_LEDS / NUM_STRIPS)
+#define UNIVERSES_PER_STRIP   ((LEDS_PER_STRIP + LEDS_PER_UNIVERSE - 1) / LEDS_PER_UNIVERSE)
+#define LED_GAMMA             2.2  // with INGEST_LUT, together with the three below
+#define LED_CORRECTION        TypicalLEDStrip
+#define LED_TEMPERATURE       UncorrectedTemperature
+#define LED_BRIGHTNESS        255
+#define RGBW_CONVERSION       fl::kRGBWExactColors  // how PIXEL_RGB_RGBW takes white out of the colour
+#define MAX_POWER_MW          0  // LED power budget in mW, brightness is cut to stay in it; 0: no limit
+#define RX_POLL_INTERVAL      50  // ms between polls of the W5100 while waiting on ETHERNET_INT_PIN
+#define ARTNET_RX_BUFFER_KB   8   // W5100/W5500 RX memory for the Art-Net socket (needs ETHERNET_LARGE_BUFFERS)
+
+// Pixel formats (PIXEL_FORMAT), converted as pixels are copied in. RGBW strips
+// are sent the LED buffer byte for byte, so it holds their pixels in wire order
+// (GRBW) and leds[] is only indexed as CRGBs on RGB strips.
+#define PIXEL_RGB      0  // 3 bytes in, RGB strips
+#define PIXEL_RGBW     1  // 4 bytes in, RGBW strips
+#define PIXEL_RGB_RGBW 2  // 3 bytes in, RGBW strips with white taken out of the colour by RGBW_CONVERSION
+#define PIXEL_RGB16    3  // 6 bytes in (16 bits a colour, high byte first), RGB strips, dithered down to 8 bits
+#define PIXEL_IN_BYTES    (PIXEL_FORMAT == PIXEL_RGBW ? 4 : PIXEL_FORMAT == PIXEL_RGB16 ? 6 : 3)
+#define PIXEL_OUT_BYTES   (PIXEL_FORMAT == PIXEL_RGBW || PIXEL_FORMAT == PIXEL_RGB_RGBW ? 4 : 3)
+#define LED_BUFFER_PIXELS ((NUM_LEDS * PIXEL_OUT_BYTES + 2) / 3)  // CRGBs in leds[]
+#define INGEST_CHANNELS   (PIXEL_FORMAT == PIXEL_RGBW ? 4 : 3)      // ingest tables: R, G, B and white in
+
+// DMX patch: which channels of which universes drive which LEDs, as a list of
+// { universe, first channel (from 1), pixels, first LED, reversed, channels
+// skipped after each pixel }. Universes must lie within START_UNIVERSE to
+// START_UNIVERSE + 7, and may have gaps and several entries each. Left
+// undefined, every universe drives LEDS_PER_UNIVERSE pixels from channel 1,
+// strip by strip. For example, 300 LEDs packed 512 channels to a universe,
+// with the second half of the string mounted backwards:
+//   #define DMX_PATCH {0, 1, 150, 0, false, 0}, {0, 451, 20, 299, true, 0}, {1, 1, 130, 279, true, 0}
+
+#if NUM_STRIPS < 1 || NUM_STRIPS > 8 || NUM_LEDS % NUM_STRIPS
+#error "NUM_STRIPS must be 1-8 and divide NUM_LEDS"
+#endif
+#if MAX_POWER_MW && NUM_STRIPS > 1 && !UNIVERSE_OUTPUT && defined(FASTLED_HAS_BLOCKLESS)
+#error "MAX_POWER_MW works through FastLED's brightness, which the parallel driver does not apply"
+#endif
+#if UNIVERSE_OUTPUT && UNIVERSES_PER_STRIP != 1
+#error "UNIVERSE_OUTPUT needs one universe per strip: set NUM_STRIPS so that a strip is at most LEDS_PER_UNIVERSE"
+#endif
+#if PIXEL_OUT_BYTES == 4 && (NUM_STRIPS > 1 || UNIVERSE_OUTPUT || MAX_POWER_MW)
+#error "RGBW pixel formats drive a single strip on WS2812_DATA_PIN, without MAX_POWER_MW"
+#endif
+#if UNIVERSE_OUTPUT && defined(DMX_PATCH)
+#error "UNIVERSE_OUTPUT shows a universe's own strip, so it can't be used with DMX_PATCH"
+#endif
+
+// With ZERO_COPY, payloads that can't be read straight into leds[] (patched
+// out of order, or changing size on the way in) are read into patchBuffer
+#if ZERO_COPY && (defined(DMX_PATCH) || PIXEL_IN_BYTES != PIXEL_OUT_BYTES)
+#define PATCH_BUFFER 1
+#else
+#define PATCH_BUFFER 0
+#endif
+
+// Frame presentation
+#define FRAME_TIMEOUT      20    // ms after a frame's first universe before it is shown with whatever has arrived
+#define ARTSYNC_TIMEOUT    4000  // ms without an ArtSync before we go back to showing on ALL_UNI_MASK
+#define SEQUENCE_RESYNC    4     // out-of-sequence packets in a row after which a universe's sender is taken to have restarted
+#define KEEPALIVE_INTERVAL 1000  // ms: with SKIP_UNCHANGED, an unchanged frame is still shown this long after the last show
+
+// Frame scheduling (FRAME_SCHEDULER)
+#define SCHEDULE_MAX_HOLD   10    // ms: the longest a complete frame is held back for its slot, and so the most latency added
+#define SCHEDULE_LOCK       8     // frames in a row at the sender's period before frames are scheduled rather than shown on arrival
+#define SCHEDULE_RESYNC     4     // frames in a row off the period after which the sender is taken to have changed rate
+#define SCHEDULE_MAX_PERIOD 1000  // ms: senders slower than this are shown on arrival
+
+// Telemetry (TELEMETRY)
+#define TELEMETRY_INTERVAL 1000  // ms between reports, and the window fps is measured over
+#define DIAG_PIECES        5     // pieces the DiagData text is formatted in, see format_diag_piece()
+
+// Trace (TRACE)
+#define TRACE_DUMP_REQUEST 'T'  // byte that makes the firmware write its trace out on Serial
+
+// Boot
+#define HELLO_STEP         200   // ms per step of the status LED dance, played from loop()
+#define DHCP_POLL_INTERVAL 20    // ms between steps of the DHCP exchange, run from loop()
+#define LEASE_EEPROM_ADDR  0     // where the last DHCP lease is kept, to be asked for again at the next boot
+#define LEASE_MAGIC        0xA7  // marks a stored lease as valid (erased EEPROM reads 0xFF)
+
+// DHCP lease as stored in EEPROM
+struct DhcpLease {
+    uint8_t magic;
+    uint8_t mac[6];  // the lease is only ours if mac[] hasn't changed
+    uint8_t ip[4];
+    uint8_t subnet[4];
+    uint8_t gateway[4];
+};
+
+// DMX patch entry, see DMX_PATCH
+struct DmxPatch {
+    uint16_t universe;
+    uint16_t channel;
+    uint16_t pixels;
+    uint16_t led;
+    bool reversed;
+    uint8_t skip;
+};
+
+// The patch compiled for the packet path: a universe's entries, clipped to
+// the payload and leds[], with neighbours that carry on from each other
+// merged into one run
+struct CopyRun {
+    uint16_t src;    // payload offset of the first pixel
+    uint16_t dst;    // leds[] index it goes to
+    uint16_t count;  // pixels
+    uint8_t stride;  // payload bytes from one pixel to the next, PIXEL_IN_BYTES unless channels are skipped
+    int8_t step;     // 1, or -1 reversed
+};
 
 // Calculated constants
 extern const uint8_t NUM_UNIVERSES;
-extern const uint8_t ALL_UNI_MASK;
+extern const uint8_t ALL_UNI_MASK;  // universes in the patch
+extern const uint8_t PATCH_ENTRIES;
 
 // Network configuration
 extern byte mac[];
 extern IPAddress ip;
 extern ArtnetEtherReceiver artnet;
+extern volatile bool packetPending;
+extern unsigned long lastReceivePoll;
+extern bool networkUp;  // we have an address: static, leased, or the stored lease while it's asked for again
+extern unsigned long lastDhcpPoll;
+extern uint8_t helloStep;  // led_hello() progress
+extern unsigned long helloTime;
 
 // LED data
 extern CRGB leds[];
+extern CLEDController* universeStrips[];         // with UNIVERSE_OUTPUT
+extern uint8_t ingestLut[INGEST_CHANNELS][256];  // with INGEST_LUT: each channel out for each value in
+extern uint8_t ingestScale[3];                   // with INGEST_LUT and PIXEL_RGB16, in place of ingestLut
+extern uint8_t ditherError[][3];                 // with PIXEL_RGB16: what each colour was rounded down by
+extern unsigned long universeShowTime[];         // with UNIVERSE_OUTPUT and SKIP_UNCHANGED
 extern uint8_t universesReceived;
 extern unsigned long lastShowTime;
 extern const unsigned long MIN_SHOW_INTERVAL;
 
+// Power limiting (MAX_POWER_MW): unscaled mW of what is in leds[], kept up to date as universes arrive
+extern uint32_t universePower[];
+extern uint32_t ledPower;
+
+// Compiled patch: universe rel's runs are patchRuns[universeRuns[rel]] up to universeRuns[rel + 1]
+extern CopyRun patchRuns[];
+extern uint8_t universeRuns[];
+extern uint8_t patchBuffer[];  // with PATCH_BUFFER
+
+// Frame assembly
+extern unsigned long frameStartTime;
+extern unsigned long partialFrames;    // frames shown with universes missing
+extern unsigned long missedUniverses;  // universes those frames were missing, in total
+
+// Frame scheduling (FRAME_SCHEDULER), times in clock_micros()
+extern bool frameHeld;               // the frame in leds[] is complete and waiting for nextRelease
+extern unsigned long sourcePeriod;   // sender's frame period, averaged; 0: not measured yet
+extern unsigned long sourceJitter;   // how far frame intervals stray from it, averaged
+extern unsigned long periodSum;      // 64 * sourcePeriod, with the fraction the average needs
+extern unsigned long jitterSum;      // 64 * sourceJitter
+extern uint8_t scheduleLock;         // frames in a row at sourcePeriod, up to SCHEDULE_LOCK
+extern uint8_t scheduleMisses;       // frames in a row off it
+extern unsigned long lastArrival;    // when the last frame was complete
+extern unsigned long nextRelease;    // the slot the held frame goes out in, or the last one used
+extern unsigned long lateFrames;     // frames complete after their slot, shown on arrival
+
+// Output and loop timing, reported with TELEMETRY
+extern unsigned long framesShown;    // show()s, or universe shows with UNIVERSE_OUTPUT
+extern unsigned long showMicros;     // how long the last one took
+extern unsigned long missedMicros;   // time micros() stood still in shows (interrupts off on AVR)
+extern unsigned long loopMicros;     // micros() at the start of the last loop()
+extern unsigned long maxLoopMicros;  // longest loop() pass since the last report
+extern unsigned long telemetryTime;  // millis() at the last report
+extern unsigned long telemetryFrames;  // framesShown at the last report
+extern uint16_t telemetryReports;
+extern uint16_t telemetryFps;  // over the last TELEMETRY_INTERVAL
+
+// Change detection (SKIP_UNCHANGED)
+extern uint16_t universeHash[];        // hash of each universe's last payload
+extern uint8_t universesChanged;       // universes changed since the last show
+extern unsigned long unchangedFrames;  // shows skipped for having nothing new
+
+// ArtDmx sequence tracking, per universe (0: the sender doesn't number its packets)
+extern uint8_t frameSequence[];     // sequence expected in the frame being assembled
+extern uint8_t lastSequence[];      // last sequence accepted
+extern uint8_t staleRun[];          // stale packets in a row
+extern unsigned long stalePackets;  // packets dropped for being older than ones already accepted
+extern unsigned long lostPackets;   // sequence numbers that never arrived
+
+// ArtSync state
+extern bool syncMode;
+extern unsigned long lastSyncTime;
+extern IPAddress dmxSource;
+
 // Function declarations
-void led_status(String led, bool state);
+void led_status(uint8_t pin, bool state);
+void show_frame();
+void show_universe(uint8_t rel, uint8_t sequence);
+void end_frame();
+void advance_sequences(uint8_t frames);
+uint8_t sequence_add(uint8_t sequence, uint8_t n);
+uint8_t sequence_distance(uint8_t from, uint8_t to);
+void count_partial_frame();
+bool schedule_frame();
+unsigned long clock_micros();
+void count_show(unsigned long startMs, unsigned long startUs);
+void service_telemetry();
+void report_telemetry();
+uint8_t format_diag_piece(uint8_t piece, char* text, uint8_t size);
+void service_trace();
+void service_frame();
+void build_ingest_lut(uint8_t brightness);
+uint32_t ingest_pixels(uint16_t led, const uint8_t* src, uint16_t count, uint8_t stride, int8_t step);
+void account_power(uint8_t rel, uint32_t power);
+uint8_t power_brightness();
+uint16_t payload_hash(const uint8_t* data, uint16_t size);
+bool universe_changed(uint8_t rel, const uint8_t* data, uint16_t size);
+void store_universe(uint8_t rel, const uint8_t* data, uint16_t size);
+uint16_t universe_leds(uint8_t rel, uint16_t& count);
+void compile_patch();
+const CopyRun* direct_run(uint8_t rel);
+bool begin_universe(uint8_t rel, uint8_t sequence);
+uint8_t* artnet_target(const ArtDmxMetadata& metadata,
+                       uint16_t size,
+                       uint16_t& capacity,
+                       const ArtNetRemoteInfo& remote);
 void artnet_callback(const uint8_t* data,
                      uint16_t size,
                      const ArtDmxMetadata& metadata,
                      const ArtNetRemoteInfo& remote);
+void artnet_sync_callback(const ArtNetRemoteInfo& remote);
+void ethernet_isr();
+void receive_packets();
 void led_hello();
 void led_oh_shit(int led_pin);
+bool load_lease(DhcpLease& lease);
+void save_lease();
+void forget_lease();
+void service_dhcp();
 void init_leds();
 void init_networking();
 
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef ARTNET_ART_DIAG_DATA_H
+#define ARTNET_ART_DIAG_DATA_H
+
+#include "Common.h"
+#include <stdint.h>
+#include <stddef.h>
+
+namespace art_net {
+namespace art_diag_data {
+
+enum Index : uint16_t
+{
+    ID = 0,
+    OP_CODE_L = 8,
+    OP_CODE_H = 9,
+    PROTOCOL_VER_H = 10,
+    PROTOCOL_VER_L = 11,
+    FILLER1 = 12,
+    PRIORITY = 13,
+    LOGICAL_PORT = 14,
+    FILLER3 = 15,
+    LENGTH_H = 16,
+    LENGTH_L = 17,
+    DATA = 18,
+
+    HEADER_SIZE = 18,
+};
+
+// DiagPriority codes
+enum Priority : uint8_t
+{
+    DP_LOW = 0x10,
+    DP_MED = 0x40,
+    DP_HIGH = 0x80,
+    DP_CRITICAL = 0xE0,
+    DP_VOLATILE = 0xF0,
+};
+
+// the text that follows is length bytes, its terminating null included
+inline void setMetadataTo(uint8_t *packet, uint8_t priority, uint16_t length)
+{
+    for (size_t i = 0; i < ID_LENGTH; i++) {
+        packet[i] = static_cast<uint8_t>(ARTNET_ID[i]);
+    }
+    packet[OP_CODE_L] = (static_cast<uint16_t>(OpCode::DiagData) >> 0) & 0x00FF;
+    packet[OP_CODE_H] = (static_cast<uint16_t>(OpCode::DiagData) >> 8) & 0x00FF;
+    packet[PROTOCOL_VER_H] = (PROTOCOL_VER >> 8) & 0x00FF;
+    packet[PROTOCOL_VER_L] = (PROTOCOL_VER >> 0) & 0x00FF;
+    packet[FILLER1] = 0;
+    packet[PRIORITY] = priority;
+    packet[LOGICAL_PORT] = 0;
+    packet[FILLER3] = 0;
+    packet[LENGTH_H] = (length >> 8) & 0x00FF;
+    packet[LENGTH_L] = (length >> 0) & 0x00FF;
+}
+
+} // namespace art_diag_data
+} // namespace art_net
+
+#endif // ARTNET_ART_DIAG_DATA_H
@@ -35,12 +35,43 @@ struct Metadata
 };
 
 using CallbackType = std::function<void(const uint8_t *data, uint16_t size, const Metadata &metadata, const RemoteInfo &remote)>;
+// Called once the header has been read, before the payload. Returns where the payload should be read to
+// and sets capacity to how many bytes fit there, or returns nullptr to skip the packet without reading it.
+using TargetCallbackType = std::function<uint8_t *(const Metadata &metadata, uint16_t size, uint16_t &capacity, const RemoteInfo &remote)>;
 #if ARX_HAVE_LIBSTDCPLUSPLUS >= 201103L  // Have libstdc++11
 using CallbackMap = std::map<uint16_t, CallbackType>;
 #else
 using CallbackMap = arx::stdx::map<uint16_t, CallbackType, FIXED_CONTAINER_CAPACITY>;
 #endif
 
+// Flat universe -> handler table, the plain function pointer counterpart of the callbacks above.
+// Sized at compile time for universes FIRST .. FIRST + COUNT - 1 (15 bit), so dispatch is one index
+// and one direct call however many universes there are. Either pointer of an entry may be nullptr.
+using TargetHandler = uint8_t *(*)(const Metadata &metadata, uint16_t size, uint16_t &capacity, const RemoteInfo &remote);
+using Handler = void (*)(const uint8_t *data, uint16_t size, const Metadata &metadata, const RemoteInfo &remote);
+
+struct UniverseHandler
+{
+    TargetHandler target;
+    Handler handler;
+};
+
+template <uint16_t FIRST, uint16_t COUNT>
+struct UniverseTable
+{
+    static_assert(COUNT > 0, "UniverseTable needs at least one universe");
+    static_assert(FIRST + COUNT <= 0x8000, "Art-Net universes are 15 bit");
+
+    UniverseHandler entries[COUNT];
+
+    void set(uint16_t universe, TargetHandler target, Handler handler)
+    {
+        if (static_cast<uint16_t>(universe - FIRST) < COUNT) {
+            this->entries[universe - FIRST] = {target, handler};
+        }
+    }
+};
+
 inline Metadata generateMetadataFrom(const uint8_t *packet)
 {
     Metadata metadata;
@@ -83,5 +114,8 @@ inline void setDataTo(uint8_t *packet, const uint16_t ch, const uint8_t data)
 
 using ArtDmxMetadata = art_net::art_dmx::Metadata;
 using ArtDmxCallback = art_net::art_dmx::CallbackType;
+using ArtDmxTargetCallback = art_net::art_dmx::TargetCallbackType;
+template <uint16_t FIRST, uint16_t COUNT>
+using ArtDmxUniverseTable = art_net::art_dmx::UniverseTable<FIRST, COUNT>;
 
 #endif // ARTNET_ARTDMX_H
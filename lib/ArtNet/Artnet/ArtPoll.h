@@ -0,0 +1,36 @@
+#pragma once
+#ifndef ARTNET_ART_POLL_H
+#define ARTNET_ART_POLL_H
+
+#include "Common.h"
+#include <stdint.h>
+#include <stddef.h>
+
+namespace art_net {
+namespace art_poll {
+
+enum Index : uint16_t
+{
+    ID = 0,
+    OP_CODE_L = 8,
+    OP_CODE_H = 9,
+    PROTOCOL_VER_H = 10,
+    PROTOCOL_VER_L = 11,
+    FLAGS = 12,
+    DIAG_PRIORITY = 13,
+
+    PACKET_SIZE = 14,
+};
+
+// Flags bits
+enum Flag : uint8_t
+{
+    REPLY_ON_CHANGE = 0x02,
+    DIAG_ENABLE = 0x04,   // send diagnostics messages
+    DIAG_UNICAST = 0x08,  // to the controller that polled, instead of broadcasting them
+};
+
+} // namespace art_poll
+} // namespace art_net
+
+#endif // ARTNET_ART_POLL_H
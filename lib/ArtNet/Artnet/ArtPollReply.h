@@ -79,6 +79,23 @@ struct Config
     uint8_t sw_in[4] {0};
 };
 
+// Point a reply at another universe: net_sw, sub_sw and sw_out[0] are all that differ between a node's replies
+inline void setPacketUniverse(Packet &r, uint16_t universe)
+{
+    r.net_sw = (universe >> 8) & 0x7F;
+    r.sub_sw = (universe >> 4) & 0x0F;
+    // https://github.com/hideakitai/ArtNet/issues/81
+    // https://github.com/hideakitai/ArtNet/issues/121
+    r.sw_out[0] = (universe >> 0) & 0x0F;
+}
+
+// Copy text into a zeroed field of size bytes, cut so that its terminating null is kept
+inline void copyText(uint8_t *field, size_t size, const String &text)
+{
+    size_t length = text.length() < size ? text.length() : size - 1;
+    memcpy(field, text.c_str(), length);
+}
+
 inline Packet generatePacketFrom(const IPAddress &my_ip, const uint8_t my_mac[6], uint16_t universe, const Config &metadata)
 {
     Packet r;
@@ -104,9 +121,9 @@ inline Packet generatePacketFrom(const IPAddress &my_ip, const uint8_t my_mac[6]
     memset(r.short_name, 0, 18);
     memset(r.long_name, 0, 64);
     memset(r.node_report, 0, 64);
-    memcpy(r.short_name, metadata.short_name.c_str(), metadata.short_name.length());
-    memcpy(r.long_name, metadata.long_name.c_str(), metadata.long_name.length());
-    memcpy(r.node_report, metadata.node_report.c_str(), metadata.node_report.length());
+    copyText(r.short_name, sizeof(r.short_name), metadata.short_name);
+    copyText(r.long_name, sizeof(r.long_name), metadata.long_name);
+    copyText(r.node_report, sizeof(r.node_report), metadata.node_report);
     r.num_ports_h = 0; // Reserved
     r.num_ports_l = 1;
     memset(r.sw_in, 0, 4);
@@ -114,11 +131,7 @@ inline Packet generatePacketFrom(const IPAddress &my_ip, const uint8_t my_mac[6]
     memset(r.port_types, 0, 4);
     memset(r.good_input, 0, 4);
     memset(r.good_output, 0, 4);
-    r.net_sw = (universe >> 8) & 0x7F;
-    r.sub_sw = (universe >> 4) & 0x0F;
-    // https://github.com/hideakitai/ArtNet/issues/81
-    // https://github.com/hideakitai/ArtNet/issues/121
-    r.sw_out[0] = (universe >> 0) & 0x0F;
+    setPacketUniverse(r, universe);
     for (size_t i = 0; i < 4; ++i) {
         r.sw_in[i] = metadata.sw_in[i] & 0x0F;
     }
@@ -63,6 +63,16 @@ constexpr double DEFAULT_INTERVAL_MS {1000. / (double)DEFAULT_FPS};
 constexpr uint16_t HEADER_SIZE {18};
 constexpr uint16_t PACKET_SIZE {530};
 
+// Receive buffer size. Payloads are only buffered for ArtDmx without a target
+// (see Receiver::subscribeArtDmxTarget), ArtNzs and ArtTrigger, so with none
+// of those subscribed this can be cut down to HEADER_SIZE to save RAM.
+// Payloads that do not fit are truncated.
+#ifndef ARTNET_RECEIVE_BUFFER_SIZE
+#define ARTNET_RECEIVE_BUFFER_SIZE 530
+#endif
+constexpr uint16_t RECEIVE_BUFFER_SIZE {ARTNET_RECEIVE_BUFFER_SIZE};
+static_assert(RECEIVE_BUFFER_SIZE >= HEADER_SIZE, "ARTNET_RECEIVE_BUFFER_SIZE must hold at least the ArtDmx header");
+
 #if ARX_HAVE_LIBSTDCPLUSPLUS >= 201103L  // Have libstdc++11
 template <uint16_t SIZE, typename T = uint8_t>
 using Array = std::array<T, SIZE>;
@@ -78,6 +88,19 @@ struct RemoteInfo
     uint16_t port;
 };
 
+// What a receiver has parsed, by OpCode
+struct ReceiveCounters
+{
+    uint32_t dmx {0};
+    uint32_t nzs {0};
+    uint32_t poll {0};
+    uint32_t sync {0};
+    uint32_t trigger {0};
+    uint32_t other {0};     // OpCodes we don't handle
+    uint32_t failed {0};    // not Art-Net
+    uint32_t filtered {0};  // ArtDmx/ArtNzs nobody took: not subscribed, or refused by the ArtDmx target
+};
+
 struct Destination
 {
     String ip;
@@ -134,5 +157,6 @@ using SequenceMap = arx::stdx::map<Destination, uint8_t, FIXED_CONTAINER_CAPACIT
 }  // namespace art_net
 
 using ArtNetRemoteInfo = art_net::RemoteInfo;
+using ArtNetReceiveCounters = art_net::ReceiveCounters;
 
 #endif  // ARTNET_COMMON_H
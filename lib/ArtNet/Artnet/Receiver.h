@@ -5,10 +5,13 @@
 #include "Common.h"
 #include "ArtDmx.h"
 #include "ArtNzs.h"
+#include "ArtPoll.h"
 #include "ArtPollReply.h"
 #include "ArtTrigger.h"
 #include "ArtSync.h"
+#include "ArtDiagData.h"
 #include "ReceiverTraits.h"
+#include <Trace.h>
 
 namespace art_net {
 
@@ -30,14 +33,30 @@ class Receiver_
 #endif
 {
     S *stream;
-    Array<PACKET_SIZE> packet;
+    Array<RECEIVE_BUFFER_SIZE> packet;
 
     art_dmx::CallbackMap callback_art_dmx_universes;
     art_dmx::CallbackType callback_art_dmx;
+    art_dmx::TargetCallbackType callback_art_dmx_target;
+    const art_dmx::UniverseHandler *art_dmx_table {nullptr};
+    uint16_t art_dmx_table_first {0};
+    uint16_t art_dmx_table_count {0};
     art_nzs::CallbackMap callback_art_nzs_universes;
     art_sync::CallbackType callback_art_sync;
     art_trigger::CallbackType callback_art_trigger;
     ArtPollReplyConfig art_poll_reply_config;
+    // Replies are sent from this one packet, only rebuilt when the config or our address changes;
+    // setPacketUniverse() points it at each universe in turn
+    art_poll_reply::Packet poll_reply;
+    bool poll_reply_stale {true};
+    bool node_report_direct {false};  // set with setArtPollReplyNodeReport(), straight into poll_reply
+
+    // What the last ArtPoll asked for in diagnostics
+    uint8_t diag_flags {0};
+    uint8_t diag_priority {0};
+    IPAddress diag_controller;
+
+    ReceiveCounters counters;
 
     Print *logger {&no_log};
 
@@ -51,6 +70,7 @@ class Receiver_
         RemoteInfo remote {};
         uint32_t requested_at_ms {0};
         uint32_t wait_ms {0};
+        uint16_t next_universe {0};  // replies are sent in universe order, one per parse()
     };
 
     Array<PENDING_POLL_REPLY_CACHE_SIZE, PendingPollReply> pending_poll_replies {};
@@ -60,7 +80,7 @@ public:
 #else
     Receiver_()
     {
-        this->packet.resize(PACKET_SIZE);
+        this->packet.resize(RECEIVE_BUFFER_SIZE);
     }
 #endif
 
@@ -72,92 +92,78 @@ public:
 
         this->processPendingPollReplies();
 
-        size_t size = this->stream->parsePacket();
-        if (size == 0) {
-            return OpCode::NoPacket;
+        return this->parseNext();
+    }
+
+    // parse every packet already waiting on the stream in one go, returns how many were parsed.
+    // On streams that support it the socket's buffer space is handed back once, after the last one.
+    uint16_t parseAll()
+    {
+        if (!isNetworkReady<S>()) {
+            return 0;
         }
 
-        this->logger->print(F("Packet received: size = "));
-        this->logger->println(size);
+        this->processPendingPollReplies();
 
-        if (size > PACKET_SIZE) {
-            this->logger->print(F("Packet size is unexpectedly too large: "));
-            this->logger->println(size);
-            size = PACKET_SIZE;
+        uint16_t count = 0;
+        beginReceiveBatch<S>(*this->stream);
+        while (this->parseNext() != OpCode::NoPacket) {
+            ++count;
         }
-        this->stream->read(this->packet.data(), size);
+        endReceiveBatch<S>(*this->stream);
+        return count;
+    }
 
-        if (!checkID()) {
-            this->logger->println(F("Packet ID is not Art-Net"));
-            return OpCode::ParseFailed;
-        }
+    // receive buffer overruns seen on the stream (0 if it can't tell)
+    uint32_t getReceiveOverruns() const
+    {
+        return this->stream ? receiveOverruns<S>(*this->stream) : 0;
+    }
 
-        RemoteInfo remote_info;
-        remote_info.ip = this->stream->S::remoteIP();
-        remote_info.port = (uint16_t)this->stream->S::remotePort();
+    // packets parsed so far, by OpCode
+    const ReceiveCounters &getReceiveCounters() const
+    {
+        return this->counters;
+    }
 
-        OpCode op_code = OpCode::Unsupported;
-        OpCode received_op_code = static_cast<OpCode>(this->getOpCode());
-        switch (received_op_code) {
-            case OpCode::Dmx: {
-                art_dmx::Metadata metadata = art_dmx::generateMetadataFrom(this->packet.data());
-                if (this->callback_art_dmx) {
-                    this->callback_art_dmx(this->getArtDmxData(), size - HEADER_SIZE, metadata, remote_info);
-                }
-                for (auto& cb : this->callback_art_dmx_universes) {
-                    if (this->getArtDmxUniverse15bit() == cb.first) {
-                        cb.second(this->getArtDmxData(), size - HEADER_SIZE, metadata, remote_info);
-                    }
-                }
-                op_code = OpCode::Dmx;
-                break;
-            }
-            case OpCode::Nzs: {
-                art_nzs::Metadata metadata = art_nzs::generateMetadataFrom(this->packet.data());
-                for (auto& cb : this->callback_art_nzs_universes) {
-                    if (this->getArtDmxUniverse15bit() == cb.first) {
-                        cb.second(this->getArtDmxData(), size - HEADER_SIZE, metadata, remote_info);
-                    }
-                }
-                op_code = OpCode::Nzs;
-                break;
-            }
-            case OpCode::Poll: {
-                this->scheduleArtPollReply(remote_info);
-                op_code = OpCode::Poll;
-                break;
-            }
-            case OpCode::Trigger: {
-                if (this->callback_art_trigger) {
-                    ArtTriggerMetadata metadata = {
-                        .oem = this->getArtTriggerOEM(),
-                        .key = this->getArtTriggerKey(),
-                        .sub_key = this->getArtTriggerSubKey(),
-                        .payload = this->getArtTriggerPayload(),
-                        .size = static_cast<uint16_t>(size - art_trigger::PAYLOAD),
-                    };
-                    this->callback_art_trigger(metadata, remote_info);
-                }
-                op_code = OpCode::Trigger;
-                break;
-            }
-            case OpCode::Sync: {
-                if (this->callback_art_sync) {
-                    this->callback_art_sync(remote_info);
-                }
-                op_code = OpCode::Sync;
-                break;
-            }
-            default: {
-                this->logger->print(F("Unsupported OpCode: "));
-                this->logger->println(this->getOpCode(), HEX);
-                op_code = OpCode::Unsupported;
-                break;
-            }
+    // send text (at most 511 characters) as an ArtDiagData packet
+    void sendArtDiagData(const IPAddress &ip, const char *text, uint8_t priority = art_diag_data::DP_LOW)
+    {
+        uint16_t length = strlen(text);
+        if (length > 511) {
+            length = 511;
         }
+        this->beginArtDiagDataTo(ip, priority, length);
+        this->stream->write((const uint8_t *)text, length);
+        this->endArtDiagData();
+    }
 
-        this->stream->flush();
-        return op_code;
+    // whether the last ArtPoll asked for diagnostics of this priority
+    bool isArtDiagDataRequested(uint8_t priority = art_diag_data::DP_LOW) const
+    {
+        return (this->diag_flags & art_poll::DIAG_ENABLE) && priority >= this->diag_priority;
+    }
+
+    // Send diagnostics the way the last ArtPoll asked for them, to the controller or broadcast, without
+    // holding the whole text: length characters (at most 511) follow in writeArtDiagData() calls, then
+    // endArtDiagData(). Returns false, sending nothing, if they weren't asked for.
+    bool beginArtDiagData(uint16_t length, uint8_t priority = art_diag_data::DP_LOW)
+    {
+        if (!this->isArtDiagDataRequested(priority)) {
+            return false;
+        }
+        const bool unicast = this->diag_flags & art_poll::DIAG_UNICAST;
+        this->beginArtDiagDataTo(unicast ? this->diag_controller : IPAddress(255, 255, 255, 255), priority, length);
+        return true;
+    }
+    void writeArtDiagData(const char *text)
+    {
+        this->stream->write((const uint8_t *)text, strlen(text));
+    }
+    void endArtDiagData()
+    {
+        this->stream->write((uint8_t)0);
+        this->stream->endPacket();
     }
 
     // subscribe artdmx packet for specified net, subnet, and universe
@@ -197,6 +203,23 @@ public:
         this->callback_art_dmx = func;
     }
 
+    // read artdmx payloads straight into the buffer returned by func,
+    // instead of the receive buffer; subscribers are then called on that buffer
+    void subscribeArtDmxTarget(const ArtDmxTargetCallback& func)
+    {
+        this->callback_art_dmx_target = func;
+    }
+
+    // dispatch artdmx packets for the table's universes through it: an index and a direct call per packet.
+    // Universes in the table bypass the artdmx target above; the other artdmx callbacks still get them.
+    template <uint16_t FIRST, uint16_t COUNT>
+    void subscribeArtDmxUniverseTable(const art_dmx::UniverseTable<FIRST, COUNT>& table)
+    {
+        this->art_dmx_table = table.entries;
+        this->art_dmx_table_first = FIRST;
+        this->art_dmx_table_count = COUNT;
+    }
+
     // subscribe other packets
     void subscribeArtSync(const ArtSyncCallback& func)
     {
@@ -229,6 +252,15 @@ public:
     {
         this->callback_art_dmx = nullptr;
     }
+    void unsubscribeArtDmxTarget()
+    {
+        this->callback_art_dmx_target = nullptr;
+    }
+    void unsubscribeArtDmxUniverseTable()
+    {
+        this->art_dmx_table = nullptr;
+        this->art_dmx_table_count = 0;
+    }
 
     void unsubscribeArtNzsUniverse(uint16_t universe)
     {
@@ -283,35 +315,56 @@ public:
     void setArtPollReplyConfigOem(uint16_t oem)
     {
         this->art_poll_reply_config.oem = oem;
+        this->poll_reply_stale = true;
     }
     void setArtPollReplyConfigEstaMan(uint16_t esta_man)
     {
         this->art_poll_reply_config.esta_man = esta_man;
+        this->poll_reply_stale = true;
     }
     void setArtPollReplyConfigStatus1(uint8_t status1)
     {
         this->art_poll_reply_config.status1 = status1;
+        this->poll_reply_stale = true;
     }
     void setArtPollReplyConfigStatus2(uint8_t status2)
     {
         this->art_poll_reply_config.status2 = status2;
+        this->poll_reply_stale = true;
     }
     void setArtPollReplyConfigShortName(const String &short_name)
     {
         this->art_poll_reply_config.short_name = short_name;
+        this->poll_reply_stale = true;
     }
     void setArtPollReplyConfigLongName(const String &long_name)
     {
         this->art_poll_reply_config.long_name = long_name;
+        this->poll_reply_stale = true;
     }
     void setArtPollReplyConfigNodeReport(const String &node_report)
     {
         this->art_poll_reply_config.node_report = node_report;
+        this->node_report_direct = false;
+        this->poll_reply_stale = true;
+    }
+    // For a NodeReport that changes often: copied into the cached reply as is, without a String or
+    // a rebuild of the reply. Cut to 63 characters.
+    void setArtPollReplyNodeReport(const char *node_report)
+    {
+        size_t length = strlen(node_report);
+        if (length >= sizeof(this->poll_reply.node_report)) {
+            length = sizeof(this->poll_reply.node_report) - 1;
+        }
+        memcpy(this->poll_reply.node_report, node_report, length);
+        this->poll_reply.node_report[length] = 0;
+        this->node_report_direct = true;
     }
     void setArtPollReplyConfigSwIn(size_t index, uint8_t sw_in)
     {
         if (index < 4) {
             this->art_poll_reply_config.sw_in[index] = sw_in;
+            this->poll_reply_stale = true;
         }
     }
     void setArtPollReplyConfigSwIn(uint8_t sw_in[4])
@@ -319,6 +372,7 @@ public:
         for (size_t i = 0; i < 4; ++i) {
             this->art_poll_reply_config.sw_in[i] = sw_in[i];
         }
+        this->poll_reply_stale = true;
     }
     void setArtPollReplyConfigSwIn(uint8_t sw_in_0, uint8_t sw_in_1, uint8_t sw_in_2, uint8_t sw_in_3)
     {
@@ -349,6 +403,7 @@ public:
     void setArtPollReplyConfig(const ArtPollReplyConfig &cfg)
     {
         this->art_poll_reply_config = cfg;
+        this->poll_reply_stale = true;
     }
 
     void setLogger(Print* logger)
@@ -364,6 +419,143 @@ protected:
 
 private:
 
+    OpCode parseNext()
+    {
+        size_t size = this->stream->parsePacket();
+        if (size == 0) {
+            return OpCode::NoPacket;
+        }
+        // begins once there is a packet, so that idle polls don't fill the trace
+        TRACE_BEGIN(TRACE_PARSE, 0);
+
+        this->logger->print(F("Packet received: size = "));
+        this->logger->println(size);
+
+        // Only the header is read up front. The payload is read only if someone wants it, straight into the
+        // ArtDmx target if there is one. Whatever is left unread is skipped by the next parsePacket(), which
+        // for EthernetUDP just moves the socket's read pointer without transferring it over SPI.
+        size_t head = size < HEADER_SIZE ? size : HEADER_SIZE;
+        this->stream->read(this->packet.data(), head);
+
+        if (!checkID()) {
+            this->counters.failed++;
+            this->logger->println(F("Packet ID is not Art-Net"));
+            TRACE_FINISH(TRACE_PARSE, 0);
+            return OpCode::ParseFailed;
+        }
+
+        RemoteInfo remote_info;
+        remote_info.ip = this->stream->S::remoteIP();
+        remote_info.port = (uint16_t)this->stream->S::remotePort();
+
+        OpCode op_code = OpCode::Unsupported;
+        OpCode received_op_code = static_cast<OpCode>(this->getOpCode());
+        switch (received_op_code) {
+            case OpCode::Dmx: {
+                op_code = OpCode::Dmx;
+                this->counters.dmx++;
+                art_dmx::Metadata metadata = art_dmx::generateMetadataFrom(this->packet.data());
+                const uint16_t universe = this->getArtDmxUniverse15bit();
+                const art_dmx::UniverseHandler *entry = this->findArtDmxTableEntry(universe);
+                const uint8_t *data = nullptr;
+                uint16_t data_size = 0;
+                uint16_t payload = size > HEADER_SIZE ? size - HEADER_SIZE : 0;
+                uint16_t capacity = 0;
+                uint8_t *target = nullptr;
+                if (entry && entry->target) {
+                    target = entry->target(metadata, payload, capacity, remote_info);
+                    if (!target) {
+                        this->counters.filtered++;
+                        break;
+                    }
+                } else if (!entry && this->callback_art_dmx_target) {
+                    target = this->callback_art_dmx_target(metadata, payload, capacity, remote_info);
+                    if (!target) {
+                        this->counters.filtered++;
+                        break;
+                    }
+                }
+                if (target) {
+                    data_size = (payload < capacity) ? payload : capacity;
+                    this->stream->read(target, data_size);
+                    data = target;
+                } else if ((entry && entry->handler) || this->isArtDmxSubscribed(universe)) {
+                    data_size = this->readPayload(size, head);
+                    data = this->getArtDmxData();
+                } else {
+                    this->counters.filtered++;
+                    break;
+                }
+                if (entry && entry->handler) {
+                    entry->handler(data, data_size, metadata, remote_info);
+                }
+                if (this->callback_art_dmx) {
+                    this->callback_art_dmx(data, data_size, metadata, remote_info);
+                }
+                auto it = this->callback_art_dmx_universes.find(universe);
+                if (it != this->callback_art_dmx_universes.end()) {
+                    it->second(data, data_size, metadata, remote_info);
+                }
+                break;
+            }
+            case OpCode::Nzs: {
+                op_code = OpCode::Nzs;
+                this->counters.nzs++;
+                auto it = this->callback_art_nzs_universes.find(this->getArtDmxUniverse15bit());
+                if (it == this->callback_art_nzs_universes.end()) {
+                    this->counters.filtered++;
+                    break;
+                }
+                uint16_t data_size = this->readPayload(size, head);
+                art_nzs::Metadata metadata = art_nzs::generateMetadataFrom(this->packet.data());
+                it->second(this->getArtDmxData(), data_size, metadata, remote_info);
+                break;
+            }
+            case OpCode::Poll: {
+                this->counters.poll++;
+                this->recordDiagRequest(size, remote_info);
+                this->scheduleArtPollReply(remote_info);
+                op_code = OpCode::Poll;
+                break;
+            }
+            case OpCode::Trigger: {
+                this->counters.trigger++;
+                if (this->callback_art_trigger) {
+                    uint16_t payload_size = this->readPayload(size, head);
+                    ArtTriggerMetadata metadata = {
+                        .oem = this->getArtTriggerOEM(),
+                        .key = this->getArtTriggerKey(),
+                        .sub_key = this->getArtTriggerSubKey(),
+                        .payload = this->getArtTriggerPayload(),
+                        .size = payload_size,
+                    };
+                    this->callback_art_trigger(metadata, remote_info);
+                }
+                op_code = OpCode::Trigger;
+                break;
+            }
+            case OpCode::Sync: {
+                this->counters.sync++;
+                if (this->callback_art_sync) {
+                    this->callback_art_sync(remote_info);
+                }
+                op_code = OpCode::Sync;
+                break;
+            }
+            default: {
+                this->counters.other++;
+                this->logger->print(F("Unsupported OpCode: "));
+                this->logger->println(this->getOpCode(), HEX);
+                op_code = OpCode::Unsupported;
+                break;
+            }
+        }
+
+        this->stream->flush();
+        TRACE_FINISH(TRACE_PARSE, this->getOpCode() >> 8);
+        return op_code;
+    }
+
     bool checkID() const
     {
         const char* idptr = reinterpret_cast<const char*>(this->packet.data());
@@ -385,43 +577,131 @@ private:
         return &(this->packet[art_dmx::DATA]);
     }
 
-    void sendArtPollReply(const RemoteInfo &remote)
+    const art_dmx::UniverseHandler *findArtDmxTableEntry(uint16_t universe) const
     {
-        const IPAddress my_ip = getLocalIP<S>();
-        uint8_t my_mac[6];
-        getMacAddress<S>(my_mac);
+        uint16_t index = universe - this->art_dmx_table_first;
+        if (!this->art_dmx_table || index >= this->art_dmx_table_count) {
+            return nullptr;
+        }
+        return &this->art_dmx_table[index];
+    }
+
+    bool isArtDmxSubscribed(uint16_t universe) const
+    {
+        if (this->callback_art_dmx) {
+            return true;
+        }
+        return this->callback_art_dmx_universes.find(universe) != this->callback_art_dmx_universes.end();
+    }
+
+    // Read the rest of the packet after the header into the receive buffer, returns the payload size
+    uint16_t readPayload(size_t size, size_t head)
+    {
+        if (size > RECEIVE_BUFFER_SIZE) {
+            this->logger->print(F("Packet size is unexpectedly too large: "));
+            this->logger->println(size);
+            size = RECEIVE_BUFFER_SIZE;
+        }
+        if (size > head) {
+            this->stream->read(this->packet.data() + head, size - head);
+        }
+        return size > HEADER_SIZE ? size - HEADER_SIZE : 0;
+    }
 
-        arx::stdx::map<uint16_t, bool> universes;
+    void beginArtDiagDataTo(const IPAddress &ip, uint8_t priority, uint16_t length)
+    {
+        uint8_t header[art_diag_data::HEADER_SIZE];
+        art_diag_data::setMetadataTo(header, priority, length + 1);
+        this->stream->beginPacket(ip, DEFAULT_PORT);
+        this->stream->write(header, art_diag_data::HEADER_SIZE);
+    }
+
+    // ArtPoll's Flags and DiagPriority say whether, where and from what priority on diagnostics are
+    // wanted. Each ArtPoll replaces what the last one asked for.
+    void recordDiagRequest(size_t size, const RemoteInfo &remote)
+    {
+        if (size <= art_poll::DIAG_PRIORITY) {
+            this->diag_flags = 0;  // Art-Net 1 ArtPoll, no diagnostics
+            return;
+        }
+        this->diag_flags = this->packet[art_poll::FLAGS];
+        this->diag_priority = this->packet[art_poll::DIAG_PRIORITY];
+        this->diag_controller = remote.ip;
+    }
+
+    // The lowest subscribed universe from `from` on. If no universe is subscribed, reply for universe 0
+    bool nextArtPollReplyUniverse(uint16_t from, uint16_t &universe) const
+    {
+        bool found = false;
+        auto consider = [&](uint16_t u) {
+            if (u >= from && (!found || u < universe)) {
+                universe = u;
+                found = true;
+            }
+        };
         for (const auto &cb_pair : this->callback_art_dmx_universes) {
-            universes[cb_pair.first] = true;
+            consider(cb_pair.first);
         }
         for (const auto &cb_pair : this->callback_art_nzs_universes) {
-            universes[cb_pair.first] = true;
+            consider(cb_pair.first);
         }
-        // if no universe is subscribed, send reply for universe 0
-        if (universes.empty()) {
-            universes[0] = true;
+        if (this->art_dmx_table_count) {
+            uint16_t last = this->art_dmx_table_first + this->art_dmx_table_count - 1;
+            if (from <= last) {
+                consider(from > this->art_dmx_table_first ? from : this->art_dmx_table_first);
+            }
         }
+        if (from == 0 && this->callback_art_dmx_universes.empty() && this->callback_art_nzs_universes.empty()
+            && !this->art_dmx_table_count) {
+            consider(0);
+        }
+        return found;
+    }
 
-        for (const auto &u_pair : universes) {
-            art_poll_reply::Packet reply = art_poll_reply::generatePacketFrom(my_ip, my_mac, u_pair.first, this->art_poll_reply_config);
-            this->stream->beginPacket(remote.ip, DEFAULT_PORT);
-            this->stream->write(reply.b, sizeof(art_poll_reply::Packet));
-            this->stream->endPacket();
+    void refreshArtPollReply()
+    {
+        const IPAddress my_ip = getLocalIP<S>();
+        bool moved = false;
+        for (size_t i = 0; i < 4; ++i) {
+            moved |= this->poll_reply.ip[i] != my_ip[i];
+        }
+        if (!this->poll_reply_stale && !moved) {
+            return;
+        }
+        uint8_t my_mac[6];
+        getMacAddress<S>(my_mac);
+        art_poll_reply::Packet reply = art_poll_reply::generatePacketFrom(my_ip, my_mac, 0, this->art_poll_reply_config);
+        if (this->node_report_direct) {
+            memcpy(reply.node_report, this->poll_reply.node_report, sizeof(reply.node_report));
         }
+        this->poll_reply = reply;
+        this->poll_reply_stale = false;
     }
 
+    // Send one due ArtPollReply, if there is one: a node with many universes answers a poll over
+    // several parse() calls rather than holding up reception for the whole burst
     void processPendingPollReplies()
     {
         const uint32_t now = millis();
         for (auto &pending : this->pending_poll_replies) {
-            if (!pending.active) {
+            if (!pending.active || now - pending.requested_at_ms < pending.wait_ms) {
                 continue;
             }
-            if (now >= pending.requested_at_ms + pending.wait_ms) {
-                this->sendArtPollReply(pending.remote);
+            uint16_t universe;
+            if (!this->nextArtPollReplyUniverse(pending.next_universe, universe)) {
                 pending.active = false;
+                continue;
             }
+            this->refreshArtPollReply();
+            art_poll_reply::setPacketUniverse(this->poll_reply, universe);
+            this->stream->beginPacket(pending.remote.ip, DEFAULT_PORT);
+            this->stream->write(this->poll_reply.b, sizeof(art_poll_reply::Packet));
+            this->stream->endPacket();
+            pending.next_universe = universe + 1;
+            if (pending.next_universe == 0) {
+                pending.active = false;
+            }
+            return;
         }
     }
 
@@ -435,6 +715,7 @@ private:
             if (!pending.active) {
                 pending.active = true;
                 pending.remote = remote;
+                pending.next_universe = 0;
                 pending.requested_at_ms = now;
                 pending.wait_ms = static_cast<uint32_t>(random(MAX_POLL_REPLY_DELAY_MS + 1));
                 return;
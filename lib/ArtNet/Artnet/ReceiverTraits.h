@@ -42,11 +42,24 @@ void getMacAddress(uint8_t mac[6]);
 template <typename T>
 bool isNetworkReady();
 
+// Batch receive, see Receiver_::parseAll(). Streams that can't batch just read packet by packet.
+template <typename T>
+inline void beginReceiveBatch(T&) {}
+template <typename T>
+inline void endReceiveBatch(T&) {}
+// Times the stream's receive buffer has run too full to take another packet, where it can tell.
+template <typename T>
+inline uint32_t receiveOverruns(const T&) { return 0; }
+
 struct IReceiver_
 {
     virtual ~IReceiver_() = default;
 
     virtual OpCode parse() = 0;
+    // parse every packet already waiting, returns how many were parsed
+    virtual uint16_t parseAll() = 0;
+    // receive buffer overruns seen on the stream (0 if it can't tell)
+    virtual uint32_t getReceiveOverruns() const = 0;
     // subscribe artdmx packet for specified net, subnet, and universe
     virtual void subscribeArtDmxUniverse(uint8_t net, uint8_t subnet, uint8_t universe, const ArtDmxCallback& func) = 0;
     // subscribe artdmx packet for specified universe (15 bit)
@@ -55,6 +68,8 @@ struct IReceiver_
     virtual void subscribeArtNzsUniverse(uint16_t universe, const ArtNzsCallback& func) = 0;
     // subscribe artdmx packet for all universes
     virtual void subscribeArtDmx(const ArtDmxCallback& func) = 0;
+    // read artdmx payloads straight into the buffer returned by func
+    virtual void subscribeArtDmxTarget(const ArtDmxTargetCallback& func) = 0;
     // subscribe other packets
     virtual void subscribeArtSync(const ArtSyncCallback& func) = 0;
     // subscribe art_trigger packet
@@ -64,6 +79,7 @@ struct IReceiver_
     virtual void unsubscribeArtDmxUniverse(uint16_t universe) = 0;
     virtual void unsubscribeArtDmxUniverses() = 0;
     virtual void unsubscribeArtDmx() = 0;
+    virtual void unsubscribeArtDmxTarget() = 0;
     virtual void unsubscribeArtNzsUniverse(uint16_t universe) = 0;
     virtual void unsubscribeArtSync() = 0;
     virtual void unsubscribeArtTrigger() = 0;
@@ -167,11 +167,11 @@ protected:
         }
 
         if (this->dmx_sequences.find(dest) == this->dmx_sequences.end()) {
-            this->dmx_sequences.insert(std::make_pair(dest, uint8_t(0)));
+            this->dmx_sequences.insert(std::make_pair(dest, uint8_t(1)));
         }
         art_dmx::setMetadataTo(this->packet.data(), this->dmx_sequences[dest], physical, dest.net, dest.subnet, dest.universe);
         this->sendRawData(dest.ip, DEFAULT_PORT, this->packet.data(), this->packet.size());
-        this->dmx_sequences[dest] = (this->dmx_sequences[dest] + 1) % 256;
+        this->dmx_sequences[dest] = nextSequence(this->dmx_sequences[dest]);
     }
 
     void sendArxNzsInternal(const Destination &dest, uint8_t start_code)
@@ -181,11 +181,17 @@ protected:
         }
 
         if (this->nzs_sequences.find(dest) == this->nzs_sequences.end()) {
-            this->nzs_sequences.insert(std::make_pair(dest, uint8_t(0)));
+            this->nzs_sequences.insert(std::make_pair(dest, uint8_t(1)));
         }
         art_nzs::setMetadataTo(this->packet.data(), this->nzs_sequences[dest], start_code, dest.net, dest.subnet, dest.universe);
         this->sendRawData(dest.ip, DEFAULT_PORT, this->packet.data(), this->packet.size());
-        this->nzs_sequences[dest] = (this->nzs_sequences[dest] + 1) % 256;
+        this->nzs_sequences[dest] = nextSequence(this->nzs_sequences[dest]);
+    }
+
+    // Art-Net sequences run 1..255 and wrap back to 1, 0 means sequencing is off
+    static uint8_t nextSequence(uint8_t sequence)
+    {
+        return (sequence == 0xFF) ? 1 : sequence + 1;
     }
 
     void sendRawData(const String& ip, uint16_t port, const uint8_t* const data, size_t size)
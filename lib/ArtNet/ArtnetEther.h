@@ -40,29 +40,47 @@ struct MacAddress<EthernetClass>
 };
 
 template <>
-IPAddress getLocalIP<EthernetUDP>()
+inline IPAddress getLocalIP<EthernetUDP>()
 {
     return LocalIP<EthernetClass>::get(Ethernet);
 }
 
 template <>
-IPAddress getSubnetMask<EthernetUDP>()
+inline IPAddress getSubnetMask<EthernetUDP>()
 {
     return SubnetMask<EthernetClass>::get(Ethernet);
 }
 
 template <>
-void getMacAddress<EthernetUDP>(uint8_t mac[6])
+inline void getMacAddress<EthernetUDP>(uint8_t mac[6])
 {
     MacAddress<EthernetClass>::get(Ethernet, mac);
 }
 
 template <>
-bool isNetworkReady<EthernetUDP>()
+inline bool isNetworkReady<EthernetUDP>()
 {
     return true;
 }
 
+template <>
+inline void beginReceiveBatch<EthernetUDP>(EthernetUDP& udp)
+{
+    udp.beginBatch();
+}
+
+template <>
+inline void endReceiveBatch<EthernetUDP>(EthernetUDP& udp)
+{
+    udp.endBatch();
+}
+
+template <>
+inline uint32_t receiveOverruns<EthernetUDP>(const EthernetUDP& udp)
+{
+    return udp.overruns();
+}
+
 } // namespace art_net
 
 #include "Artnet/Manager.h"
@@ -73,23 +73,8 @@ int DhcpClass::request_DHCP_lease()
 			uint32_t respId;
 			messageType = parseDHCPResponse(_responseTimeout, respId);
 			if (messageType == DHCP_ACK) {
-				_dhcp_state = STATE_DHCP_LEASED;
+				lease_granted();
 				result = 1;
-				//use default lease time if we didn't get it
-				if (_dhcpLeaseTime == 0) {
-					_dhcpLeaseTime = DEFAULT_LEASE;
-				}
-				// Calculate T1 & T2 if we didn't get it
-				if (_dhcpT1 == 0) {
-					// T1 should be 50% of _dhcpLeaseTime
-					_dhcpT1 = _dhcpLeaseTime >> 1;
-				}
-				if (_dhcpT2 == 0) {
-					// T2 should be 87.5% (7/8ths) of _dhcpLeaseTime
-					_dhcpT2 = _dhcpLeaseTime - (_dhcpLeaseTime >> 3);
-				}
-				_renewInSec = _dhcpT1;
-				_rebindInSec = _dhcpT2;
 			} else if (messageType == DHCP_NAK) {
 				_dhcp_state = STATE_DHCP_START;
 			}
@@ -112,6 +97,27 @@ int DhcpClass::request_DHCP_lease()
 	return result;
 }
 
+void DhcpClass::lease_granted()
+{
+	_dhcp_state = STATE_DHCP_LEASED;
+	_haveLease = true;
+	//use default lease time if we didn't get it
+	if (_dhcpLeaseTime == 0) {
+		_dhcpLeaseTime = DEFAULT_LEASE;
+	}
+	// Calculate T1 & T2 if we didn't get it
+	if (_dhcpT1 == 0) {
+		// T1 should be 50% of _dhcpLeaseTime
+		_dhcpT1 = _dhcpLeaseTime >> 1;
+	}
+	if (_dhcpT2 == 0) {
+		// T2 should be 87.5% (7/8ths) of _dhcpLeaseTime
+		_dhcpT2 = _dhcpLeaseTime - (_dhcpLeaseTime >> 3);
+	}
+	_renewInSec = _dhcpT1;
+	_rebindInSec = _dhcpT2;
+}
+
 void DhcpClass::presend_DHCP()
 {
 }
@@ -213,8 +219,9 @@ void DhcpClass::send_DHCP_MESSAGE(uint8_t messageType, uint16_t secondsElapsed)
 		buffer[10] = _dhcpDhcpServerIp[2];
 		buffer[11] = _dhcpDhcpServerIp[3];
 
-		//put data in W5100 transmit buffer
-		_dhcpUdpSocket.write(buffer, 12);
+		//put data in W5100 transmit buffer, without the server
+		//identifier when asking for a previous lease (INIT-REBOOT)
+		_dhcpUdpSocket.write(buffer, IPAddress(_dhcpDhcpServerIp) == IPAddress((uint32_t)0) ? 6 : 12);
 	}
 
 	buffer[0] = dhcpParamRequest;
@@ -235,9 +242,6 @@ void DhcpClass::send_DHCP_MESSAGE(uint8_t messageType, uint16_t secondsElapsed)
 
 uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& transactionId)
 {
-	uint8_t type = 0;
-	uint8_t opt_len = 0;
-
 	unsigned long startTime = millis();
 
 	while (_dhcpUdpSocket.parsePacket() <= 0) {
@@ -246,6 +250,15 @@ uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& tr
 		}
 		delay(50);
 	}
+	return readDHCPResponse(transactionId);
+}
+
+// Read the reply parsePacket() has just found
+uint8_t DhcpClass::readDHCPResponse(uint32_t& transactionId)
+{
+	uint8_t type = 0;
+	uint8_t opt_len = 0;
+
 	// start reading in the packet
 	RIP_MSG_FIXED fixedMsg;
 	_dhcpUdpSocket.read((uint8_t*)&fixedMsg, sizeof(RIP_MSG_FIXED));
@@ -353,6 +366,28 @@ int DhcpClass::checkLease()
 {
 	int rc = DHCP_CHECK_NONE;
 
+	count_down_lease();
+
+	// if we have a lease but should renew, do it
+	if (_renewInSec == 0 &&_dhcp_state == STATE_DHCP_LEASED) {
+		_dhcp_state = STATE_DHCP_REREQUEST;
+		rc = 1 + request_DHCP_lease();
+	}
+
+	// if we have a lease or is renewing but should bind, do it
+	if (_rebindInSec == 0 && (_dhcp_state == STATE_DHCP_LEASED ||
+	  _dhcp_state == STATE_DHCP_START)) {
+		// this should basically restart completely
+		_dhcp_state = STATE_DHCP_START;
+		reset_DHCP_lease();
+		rc = 3 + request_DHCP_lease();
+	}
+	return rc;
+}
+
+// Take the seconds passed since the last call off the renew and rebind timers
+void DhcpClass::count_down_lease()
+{
 	unsigned long now = millis();
 	unsigned long elapsed = now - _lastCheckLeaseMillis;
 
@@ -377,22 +412,113 @@ int DhcpClass::checkLease()
 			_rebindInSec -= elapsed;
 		}
 	}
+}
 
-	// if we have a lease but should renew, do it
-	if (_renewInSec == 0 &&_dhcp_state == STATE_DHCP_LEASED) {
+void DhcpClass::beginAsync(uint8_t *mac, IPAddress ip, unsigned long responseTimeout)
+{
+	_dhcpLeaseTime=0;
+	_dhcpT1=0;
+	_dhcpT2=0;
+	_responseTimeout = responseTimeout;
+	_haveLease = false;
+	_socketOpen = false;
+
+	reset_DHCP_lease();
+	memcpy((void*)_dhcpMacAddr, (void*)mac, 6);
+	_dhcpTransactionId = random(1UL, 2000UL);
+	_dhcpInitialTransactionId = _dhcpTransactionId;
+	_startMillis = millis();
+
+	// Nothing is sent until the first poll()
+	if ((uint32_t)ip != 0) {
+		memcpy(_dhcpLocalIp, ip.raw_address(), 4);
 		_dhcp_state = STATE_DHCP_REREQUEST;
-		rc = 1 + request_DHCP_lease();
+	} else {
+		_dhcp_state = STATE_DHCP_START;
 	}
+}
 
-	// if we have a lease or is renewing but should bind, do it
-	if (_rebindInSec == 0 && (_dhcp_state == STATE_DHCP_LEASED ||
-	  _dhcp_state == STATE_DHCP_START)) {
-		// this should basically restart completely
-		_dhcp_state = STATE_DHCP_START;
+// Send the next message of a non-blocking exchange and move on to the state
+// that waits for its reply.  If no socket can be had, the timeout in poll()
+// tries again.
+void DhcpClass::send_async(uint8_t messageType, uint8_t nextState)
+{
+	_dhcp_state = nextState;
+	_sentMillis = millis();
+	if (!_socketOpen) {
+		if (_dhcpUdpSocket.begin(DHCP_CLIENT_PORT) == 0) return;
+		_socketOpen = true;
+	}
+	send_DHCP_MESSAGE(messageType, (_sentMillis - _startMillis) / 1000);
+}
+
+/*
+    One step of the non-blocking exchange, returns:
+    DHCP_POLL_WAITING: nothing new
+    DHCP_POLL_LEASED: an ACK came in, the lease is in getLocalIp() etc.
+    DHCP_POLL_REFUSED: a NAK came in, the address asked for isn't ours
+*/
+int DhcpClass::poll()
+{
+	uint32_t respId;
+	uint8_t messageType;
+
+	if (_dhcp_state == STATE_DHCP_LEASED) {
+		count_down_lease();
+		if (_rebindInSec == 0) {
+			// the server that gave us the lease is gone: start over
+			_haveLease = false;
+			_dhcp_state = STATE_DHCP_START;
+		} else if (_renewInSec == 0) {
+			_dhcp_state = STATE_DHCP_REREQUEST;
+		} else {
+			return DHCP_POLL_WAITING;
+		}
+	}
+	if (_dhcp_state == STATE_DHCP_START) {
 		reset_DHCP_lease();
-		rc = 3 + request_DHCP_lease();
+		_dhcpTransactionId++;
+		send_async(DHCP_DISCOVER, STATE_DHCP_DISCOVER);
+		return DHCP_POLL_WAITING;
 	}
-	return rc;
+	if (_dhcp_state == STATE_DHCP_REREQUEST) {
+		// renewing our lease, or asking for a previous one's address
+		_dhcpTransactionId++;
+		send_async(DHCP_REQUEST, _haveLease ? STATE_DHCP_REQUEST : STATE_DHCP_REBOOT);
+		return DHCP_POLL_WAITING;
+	}
+
+	if (_socketOpen && _dhcpUdpSocket.parsePacket() > 0) {
+		messageType = readDHCPResponse(respId);
+		if (messageType == DHCP_OFFER && _dhcp_state == STATE_DHCP_DISCOVER) {
+			// We'll use the transaction ID that the offer came with,
+			// rather than the one we were up to
+			_dhcpTransactionId = respId;
+			send_async(DHCP_REQUEST, STATE_DHCP_REQUEST);
+		} else if (messageType == DHCP_ACK && _dhcp_state != STATE_DHCP_DISCOVER) {
+			lease_granted();
+			// We're done with the socket until the lease is renewed
+			_dhcpUdpSocket.stop();
+			_socketOpen = false;
+			_dhcpTransactionId++;
+			_lastCheckLeaseMillis = millis();
+			return DHCP_POLL_LEASED;
+		} else if (messageType == DHCP_NAK) {
+			_haveLease = false;
+			_dhcp_state = STATE_DHCP_START;
+			return DHCP_POLL_REFUSED;
+		}
+	} else if (millis() - _sentMillis > _responseTimeout) {
+		if (_haveLease) {
+			// no answer to a renewal: keep the lease, ask again in a minute
+			_renewInSec = 60;
+			_dhcp_state = STATE_DHCP_LEASED;
+		} else {
+			// no answer: keep whatever address is in use and DISCOVER
+			_dhcp_state = STATE_DHCP_START;
+		}
+	}
+	return DHCP_POLL_WAITING;
 }
 
 IPAddress DhcpClass::getLocalIp()
@@ -11,6 +11,7 @@
 #define	STATE_DHCP_LEASED	3
 #define	STATE_DHCP_REREQUEST	4
 #define	STATE_DHCP_RELEASE	5
+#define	STATE_DHCP_REBOOT	6	/* asking for a previous lease's address again */
 
 #define DHCP_FLAGSBROADCAST	0x8000
 
@@ -54,6 +54,43 @@ int EthernetClass::begin(uint8_t *mac, unsigned long timeout, unsigned long resp
 	return ret;
 }
 
+int EthernetClass::beginDHCP(uint8_t *mac, IPAddress ip, IPAddress subnet, IPAddress gateway, unsigned long responseTimeout)
+{
+	static DhcpClass s_dhcp;
+	_dhcp = &s_dhcp;
+
+	if (W5100.init() == 0) return 0;
+	SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+	W5100.setMACAddress(mac);
+	W5100.setIPAddress(ip.raw_address());
+	W5100.setGatewayIp(gateway.raw_address());
+	W5100.setSubnetMask(subnet.raw_address());
+	SPI.endTransaction();
+	_dhcp->beginAsync(mac, ip, responseTimeout);
+	return 1;
+}
+
+int EthernetClass::maintainDHCP()
+{
+	if (_dhcp == NULL) return DHCP_POLL_WAITING;
+	int rc = _dhcp->poll();
+	if (rc == DHCP_POLL_LEASED) {
+		SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+		W5100.setIPAddress(_dhcp->getLocalIp().raw_address());
+		W5100.setGatewayIp(_dhcp->getGatewayIp().raw_address());
+		W5100.setSubnetMask(_dhcp->getSubnetMask().raw_address());
+		SPI.endTransaction();
+		_dnsServerAddress = _dhcp->getDnsServerIp();
+		socketPortRand(micros());
+	} else if (rc == DHCP_POLL_REFUSED) {
+		// the address isn't ours to use any more
+		SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+		W5100.setIPAddress(IPAddress(0,0,0,0).raw_address());
+		SPI.endTransaction();
+	}
+	return rc;
+}
+
 void EthernetClass::begin(uint8_t *mac, IPAddress ip)
 {
 	// Assume the DNS server will be the machine on the same network as the local IP
@@ -224,6 +261,14 @@ void EthernetClass::setRetransmissionCount(uint8_t num)
 	SPI.endTransaction();
 }
 
+#ifdef ETHERNET_LARGE_BUFFERS
+void EthernetClass::setSocketBufferSize(uint8_t s, uint8_t rxKB, uint8_t txKB)
+{
+	if (s >= MAX_SOCK_NUM) return;
+	W5100.setBufferSize(s, rxKB, txKB);
+}
+#endif
+
 
 
 
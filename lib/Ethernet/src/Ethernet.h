@@ -45,6 +45,8 @@
 // can really help with UDP protocols like Artnet.  In theory larger
 // buffers should allow faster TCP over high-latency links, but this
 // does not always seem to work in practice (maybe WIZnet bugs?)
+// With large buffers, Ethernet.setSocketBufferSize() can also give one
+// socket more of the chip's memory than the others.
 //#define ETHERNET_LARGE_BUFFERS
 
 
@@ -71,6 +73,11 @@ class EthernetClient;
 class EthernetServer;
 class DhcpClass;
 
+// maintainDHCP() results
+#define DHCP_POLL_WAITING	0	// nothing new
+#define DHCP_POLL_LEASED	1	// a lease was granted or renewed, and is now in use
+#define DHCP_POLL_REFUSED	2	// the server refused the address asked for, which was dropped
+
 class EthernetClass {
 private:
 	static IPAddress _dnsServerAddress;
@@ -81,6 +88,16 @@ public:
 	// Returns 0 if the DHCP configuration failed, and 1 if it succeeded
 	static int begin(uint8_t *mac, unsigned long timeout = 60000, unsigned long responseTimeout = 4000);
 	static int maintain();
+
+	// Non-blocking DHCP: beginDHCP() sets the chip up with ip, subnet and
+	// gateway (the last lease, say, or 0.0.0.0) and returns at once, and
+	// maintainDHCP(), called often from loop(), gets and renews the lease
+	// one step at a time.  A non-zero ip is asked for again with a REQUEST
+	// before falling back to DISCOVER.  The DHCP socket is only open while
+	// a message is outstanding.  Returns 0 if there is no chip.
+	static int beginDHCP(uint8_t *mac, IPAddress ip = IPAddress(0,0,0,0), IPAddress subnet = IPAddress(0,0,0,0),
+		IPAddress gateway = IPAddress(0,0,0,0), unsigned long responseTimeout = 4000);
+	static int maintainDHCP();
 	static EthernetLinkStatus linkStatus();
 	static EthernetHardwareStatus hardwareStatus();
 
@@ -105,6 +122,21 @@ public:
 	void setRetransmissionTimeout(uint16_t milliseconds);
 	void setRetransmissionCount(uint8_t num);
 
+	// Interrupt driven receive: have the chip pull its INT pin low when
+	// data arrives on any socket.  INT stays low until clearRecvInterrupt()
+	// is called, which should be done before reading the sockets so a packet
+	// arriving meanwhile pulls INT low again.
+	static void enableRecvInterrupt();
+	static void clearRecvInterrupt();
+
+#ifdef ETHERNET_LARGE_BUFFERS
+	// Size in KB of socket s's RX and TX buffers inside the chip, out of
+	// 8K each on W5100 and 16K on W5200/W5500, rounded down to 1, 2, 4, 8
+	// or 16.  Takes effect at the next begin().  Sockets left at 0 share
+	// out whatever memory remains, and one left with none can't be opened.
+	static void setSocketBufferSize(uint8_t s, uint8_t rxKB, uint8_t txKB = 0);
+#endif
+
 	friend class EthernetClient;
 	friend class EthernetServer;
 	friend class EthernetUDP;
@@ -128,6 +160,9 @@ private:
 	static int socketRecv(uint8_t s, uint8_t * buf, int16_t len);
 	static uint16_t socketRecvAvailable(uint8_t s);
 	static uint8_t socketPeek(uint8_t s);
+	// Receive several packets with one RX_RD writeback (UDP)
+	static uint16_t socketRecvBeginBatch(uint8_t s);
+	static void socketRecvEndBatch(uint8_t s);
 	// sets up a UDP datagram, the data for which will be provided by one
 	// or more calls to bufferData and then finally sent with sendUDP.
 	// return true if the datagram was successfully set up, or false if there was an error
@@ -155,13 +190,15 @@ private:
 	IPAddress _remoteIP; // remote IP address for the incoming packet whilst it's being processed
 	uint16_t _remotePort; // remote port for the incoming packet whilst it's being processed
 	uint16_t _offset; // offset into the packet being sent
+	uint16_t _largest; // largest packet received so far
+	unsigned long _overruns; // batches that found the RX buffer too full for another packet
 
 protected:
 	uint8_t sockindex;
 	uint16_t _remaining; // remaining bytes of incoming packet yet to be processed
 
 public:
-	EthernetUDP() : sockindex(MAX_SOCK_NUM) {}  // Constructor
+	EthernetUDP() : _largest(0), _overruns(0), sockindex(MAX_SOCK_NUM) {}  // Constructor
 	virtual uint8_t begin(uint16_t);      // initialize, start listening on specified port. Returns 1 if successful, 0 if there are no sockets available to use
 	virtual uint8_t beginMulticast(IPAddress, uint16_t);  // initialize, start listening on specified port. Returns 1 if successful, 0 if there are no sockets available to use
 	virtual void stop();  // Finish with the UDP socket
@@ -201,6 +238,17 @@ public:
 	virtual int peek();
 	virtual void flush(); // Finish reading the current packet
 
+	// Batch receive: every packet already waiting can be read with
+	// parsePacket() between beginBatch() and endBatch(), and the buffer
+	// space is handed back to the chip once, at endBatch()
+	// Returns the number of bytes waiting at the start of the batch
+	int beginBatch();
+	void endBatch();
+	// Number of batches that started with too little room left in the
+	// chip's RX buffer for another packet as big as the largest seen so
+	// far, i.e. with the chip likely to have dropped packets
+	unsigned long overruns() const { return _overruns; }
+
 	// Return the IP address of the host who sent the current incoming packet
 	virtual IPAddress remoteIP() { return _remoteIP; };
 	// Return the port of the host who sent the current incoming packet
@@ -295,16 +343,24 @@ private:
 	unsigned long _timeout;
 	unsigned long _responseTimeout;
 	unsigned long _lastCheckLeaseMillis;
+	unsigned long _startMillis;
+	unsigned long _sentMillis;
 	uint8_t _dhcp_state;
+	bool _haveLease;
+	bool _socketOpen;
 	EthernetUDP _dhcpUdpSocket;
 
 	int request_DHCP_lease();
 	void reset_DHCP_lease();
 	void presend_DHCP();
 	void send_DHCP_MESSAGE(uint8_t, uint16_t);
+	void send_async(uint8_t messageType, uint8_t nextState);
+	void lease_granted();
+	void count_down_lease();
 	void printByte(char *, uint8_t);
 
 	uint8_t parseDHCPResponse(unsigned long responseTimeout, uint32_t& transactionId);
+	uint8_t readDHCPResponse(uint32_t& transactionId);
 public:
 	IPAddress getLocalIp();
 	IPAddress getSubnetMask();
@@ -314,6 +370,10 @@ public:
 
 	int beginWithDHCP(uint8_t *, unsigned long timeout = 60000, unsigned long responseTimeout = 4000);
 	int checkLease();
+
+	// Non-blocking counterparts, see EthernetClass::beginDHCP()
+	void beginAsync(uint8_t *mac, IPAddress ip, unsigned long responseTimeout);
+	int poll();
 };
 
 
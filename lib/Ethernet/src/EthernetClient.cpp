@@ -125,7 +125,7 @@ void EthernetClient::flush()
 	while (_sockindex < MAX_SOCK_NUM) {
 		uint8_t stat = Ethernet.socketStatus(_sockindex);
 		if (stat != SnSR::ESTABLISHED && stat != SnSR::CLOSE_WAIT) return;
-		if (Ethernet.socketSendAvailable(_sockindex) >= W5100.SSIZE) return;
+		if (Ethernet.socketSendAvailable(_sockindex) >= W5100.TXSIZE(_sockindex)) return;
 	}
 }
 
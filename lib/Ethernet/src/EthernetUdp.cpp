@@ -118,6 +118,7 @@ int EthernetUDP::parsePacket()
 			_remotePort = (_remotePort << 8) + tmpBuf[5];
 			_remaining = tmpBuf[6];
 			_remaining = (_remaining << 8) + tmpBuf[7];
+			if (_remaining > _largest) _largest = _remaining;
 
 			// When we get here, any remaining bytes are the data
 			ret = _remaining;
@@ -178,6 +179,25 @@ void EthernetUDP::flush()
 	// TODO: we should wait for TX buffer to be emptied
 }
 
+int EthernetUDP::beginBatch()
+{
+	if (sockindex >= MAX_SOCK_NUM) return 0;
+	uint16_t waiting = Ethernet.socketRecvBeginBatch(sockindex);
+	// the chip drops a packet that doesn't fit, header included
+	if (W5100.RXSIZE(sockindex) - waiting < _largest + 8) _overruns++;
+	return waiting;
+}
+
+void EthernetUDP::endBatch()
+{
+	if (sockindex >= MAX_SOCK_NUM) return;
+	// discard any remaining bytes in the last packet
+	while (_remaining) {
+		read((uint8_t *)NULL, _remaining);
+	}
+	Ethernet.socketRecvEndBatch(sockindex);
+}
+
 /* Start EthernetUDP socket, listening at local port PORT */
 uint8_t EthernetUDP::beginMulticast(IPAddress ip, uint16_t port)
 {
@@ -21,6 +21,7 @@
 #include <Arduino.h>
 #include "Ethernet.h"
 #include "utility/w5100.h"
+#include <Trace.h>
 
 #if ARDUINO >= 156 && !defined(ARDUINO_ARCH_PIC32)
 extern void yield(void);
@@ -35,7 +36,8 @@ typedef struct {
 	uint16_t RX_RSR; // Number of bytes received
 	uint16_t RX_RD;  // Address to read
 	uint16_t TX_FSR; // Free space ready for transmit
-	uint8_t  RX_inc; // how much have we advanced RX_RD
+	uint16_t RX_inc; // how much have we advanced RX_RD
+	uint8_t  RX_batch; // defer RX_RD writeback until socketRecvEndBatch
 } socketstate_t;
 
 static socketstate_t state[MAX_SOCK_NUM];
@@ -75,7 +77,8 @@ uint8_t EthernetClass::socketBegin(uint8_t protocol, uint16_t port)
 	// look at all the hardware sockets, use any that are closed (unused)
 	for (s=0; s < maxindex; s++) {
 		status[s] = W5100.readSnSR(s);
-		if (status[s] == SnSR::CLOSED) goto makesocket;
+		// sockets left without buffer memory (see setSocketBufferSize) can't be used
+		if (status[s] == SnSR::CLOSED && W5100.RXSIZE(s) && W5100.TXSIZE(s)) goto makesocket;
 	}
 	//Serial.printf("W5000socket step2\n");
 	// as a last resort, forcibly close any already closing
@@ -117,6 +120,7 @@ makesocket:
 	state[s].RX_RSR = 0;
 	state[s].RX_RD  = W5100.readSnRX_RD(s); // always zero?
 	state[s].RX_inc = 0;
+	state[s].RX_batch = 0;
 	state[s].TX_FSR = 0;
 	//Serial.printf("W5000socket prot=%d, RX_RD=%d\n", W5100.readSnMR(s), state[s].RX_RD);
 	SPI.endTransaction();
@@ -139,7 +143,8 @@ uint8_t EthernetClass::socketBeginMulticast(uint8_t protocol, IPAddress ip, uint
 	// look at all the hardware sockets, use any that are closed (unused)
 	for (s=0; s < maxindex; s++) {
 		status[s] = W5100.readSnSR(s);
-		if (status[s] == SnSR::CLOSED) goto makesocket;
+		// sockets left without buffer memory (see setSocketBufferSize) can't be used
+		if (status[s] == SnSR::CLOSED && W5100.RXSIZE(s) && W5100.TXSIZE(s)) goto makesocket;
 	}
 	//Serial.printf("W5000socket step2\n");
 	// as a last resort, forcibly close any already closing
@@ -189,6 +194,7 @@ makesocket:
 	state[s].RX_RSR = 0;
 	state[s].RX_RD  = W5100.readSnRX_RD(s); // always zero?
 	state[s].RX_inc = 0;
+	state[s].RX_batch = 0;
 	state[s].TX_FSR = 0;
 	//Serial.printf("W5000socket prot=%d, RX_RD=%d\n", W5100.readSnMR(s), state[s].RX_RD);
 	SPI.endTransaction();
@@ -286,13 +292,13 @@ static void read_data(uint8_t s, uint16_t src, uint8_t *dst, uint16_t len)
 	uint16_t src_ptr;
 
 	//Serial.printf("read_data, len=%d, at:%d\n", len, src);
-	src_mask = (uint16_t)src & W5100.SMASK;
+	src_mask = (uint16_t)src & W5100.RXMASK(s);
 	src_ptr = W5100.RBASE(s) + src_mask;
 
-	if (W5100.hasOffsetAddressMapping() || src_mask + len <= W5100.SSIZE) {
+	if (W5100.hasOffsetAddressMapping() || src_mask + len <= W5100.RXSIZE(s)) {
 		W5100.read(src_ptr, dst, len);
 	} else {
-		size = W5100.SSIZE - src_mask;
+		size = W5100.RXSIZE(s) - src_mask;
 		W5100.read(src_ptr, dst, size);
 		dst += size;
 		W5100.read(W5100.RBASE(s), dst, len - size);
@@ -303,6 +309,7 @@ static void read_data(uint8_t s, uint16_t src, uint8_t *dst, uint16_t len)
 //
 int EthernetClass::socketRecv(uint8_t s, uint8_t *buf, int16_t len)
 {
+	TRACE_BEGIN(TRACE_RECV, s);
 	// Check how much data is available
 	int ret = state[s].RX_RSR;
 	SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
@@ -332,7 +339,9 @@ int EthernetClass::socketRecv(uint8_t s, uint8_t *buf, int16_t len)
 		state[s].RX_RD = ptr;
 		state[s].RX_RSR -= ret;
 		uint16_t inc = state[s].RX_inc + ret;
-		if (inc >= 250 || state[s].RX_RSR == 0) {
+		if (state[s].RX_batch) {
+			state[s].RX_inc = inc;
+		} else if (inc >= 250 || state[s].RX_RSR == 0) {
 			state[s].RX_inc = 0;
 			W5100.writeSnRX_RD(s, ptr);
 			W5100.execCmdSn(s, Sock_RECV);
@@ -344,13 +353,14 @@ int EthernetClass::socketRecv(uint8_t s, uint8_t *buf, int16_t len)
 	}
 	SPI.endTransaction();
 	//Serial.printf("socketRecv, ret=%d\n", ret);
+	TRACE_FINISH(TRACE_RECV, s);
 	return ret;
 }
 
 uint16_t EthernetClass::socketRecvAvailable(uint8_t s)
 {
 	uint16_t ret = state[s].RX_RSR;
-	if (ret == 0) {
+	if (ret == 0 && !state[s].RX_batch) {
 		SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
 		uint16_t rsr = getSnRX_RSR(s);
 		SPI.endTransaction();
@@ -361,6 +371,71 @@ uint16_t EthernetClass::socketRecvAvailable(uint8_t s)
 	return ret;
 }
 
+// Batch receive: takes one look at how much data is waiting, then lets
+// socketRecv walk through all of it without writing RX_RD back to the
+// chip after every packet.  socketRecvEndBatch releases the space read
+// with a single RX_RD write and Sock_RECV command.  Data arriving during
+// the batch is picked up by the next one.
+uint16_t EthernetClass::socketRecvBeginBatch(uint8_t s)
+{
+	state[s].RX_batch = 0;
+	uint16_t ret = socketRecvAvailable(s);
+	state[s].RX_batch = 1;
+	return ret;
+}
+
+void EthernetClass::socketRecvEndBatch(uint8_t s)
+{
+	state[s].RX_batch = 0;
+	if (state[s].RX_inc == 0) return;
+	SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+	state[s].RX_inc = 0;
+	W5100.writeSnRX_RD(s, state[s].RX_RD);
+	W5100.execCmdSn(s, Sock_RECV);
+	SPI.endTransaction();
+}
+
+void EthernetClass::enableRecvInterrupt()
+{
+	uint8_t s, chip, maxindex=MAX_SOCK_NUM;
+
+	chip = W5100.getChip();
+	if (!chip) return;
+	if (chip == 51) maxindex = 4; // W5100 chip never supports more than 4 sockets
+	uint8_t mask = (1 << maxindex) - 1;
+	SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+	if (chip == 51) {
+		// W5100 has no per socket mask, SEND_OK etc. will pull INT low too
+		W5100.writeIMR(mask);
+	} else {
+		for (s=0; s < maxindex; s++) {
+			W5100.writeSnIMR(s, SnIR::RECV);
+		}
+		if (chip == 55) {
+			W5100.writeSIMR_W5500(mask);
+		} else {
+			W5100.writeIMR_W5200(mask);
+		}
+	}
+	SPI.endTransaction();
+}
+
+void EthernetClass::clearRecvInterrupt()
+{
+	uint8_t s, chip, maxindex=MAX_SOCK_NUM;
+
+	chip = W5100.getChip();
+	if (!chip) return;
+	if (chip == 51) maxindex = 4; // W5100 chip never supports more than 4 sockets
+	SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+	// The W5200's IR2 and W5500's SIR clear themselves once a socket's
+	// SnIR is clear; only RECV is unmasked, and SEND_OK is cleared by sends
+	for (s=0; s < maxindex; s++) {
+		W5100.writeSnIR(s, SnIR::RECV);
+	}
+	SPI.endTransaction();
+}
+
 // get the first byte in the receive queue (no checking)
 //
 uint8_t EthernetClass::socketPeek(uint8_t s)
@@ -368,7 +443,7 @@ uint8_t EthernetClass::socketPeek(uint8_t s)
 	uint8_t b;
 	SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
 	uint16_t ptr = state[s].RX_RD;
-	W5100.read((ptr & W5100.SMASK) + W5100.RBASE(s), &b, 1);
+	W5100.read((ptr & W5100.RXMASK(s)) + W5100.RBASE(s), &b, 1);
 	SPI.endTransaction();
 	return b;
 }
@@ -399,14 +474,14 @@ static void write_data(uint8_t s, uint16_t data_offset, const uint8_t *data, uin
 {
 	uint16_t ptr = W5100.readSnTX_WR(s);
 	ptr += data_offset;
-	uint16_t offset = ptr & W5100.SMASK;
+	uint16_t offset = ptr & W5100.TXMASK(s);
 	uint16_t dstAddr = offset + W5100.SBASE(s);
 
-	if (W5100.hasOffsetAddressMapping() || offset + len <= W5100.SSIZE) {
+	if (W5100.hasOffsetAddressMapping() || offset + len <= W5100.TXSIZE(s)) {
 		W5100.write(dstAddr, data, len);
 	} else {
 		// Wrap around circular buffer
-		uint16_t size = W5100.SSIZE - offset;
+		uint16_t size = W5100.TXSIZE(s) - offset;
 		W5100.write(dstAddr, data, size);
 		W5100.write(W5100.SBASE(s), data + size, len - size);
 	}
@@ -425,8 +500,8 @@ uint16_t EthernetClass::socketSend(uint8_t s, const uint8_t * buf, uint16_t len)
 	uint16_t ret=0;
 	uint16_t freesize=0;
 
-	if (len > W5100.SSIZE) {
-		ret = W5100.SSIZE; // check size not to exceed MAX size.
+	if (len > W5100.TXSIZE(s)) {
+		ret = W5100.TXSIZE(s); // check size not to exceed MAX size.
 	} else {
 		ret = len;
 	}
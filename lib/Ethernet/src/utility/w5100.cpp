@@ -46,6 +46,10 @@
 #define SS_PIN_DEFAULT  10
 #endif
 
+// ms after power-up the chip's reset pulse may last, see init()
+#ifndef ETHERNET_RESET_WAIT
+#define ETHERNET_RESET_WAIT  560
+#endif
 
 
 
@@ -54,8 +58,10 @@ uint8_t  W5100Class::chip = 0;
 uint8_t  W5100Class::CH_BASE_MSB;
 uint8_t  W5100Class::ss_pin = SS_PIN_DEFAULT;
 #ifdef ETHERNET_LARGE_BUFFERS
-uint16_t W5100Class::SSIZE = 2048;
-uint16_t W5100Class::SMASK = 0x07FF;
+uint8_t  W5100Class::txsize_kb[MAX_SOCK_NUM];
+uint8_t  W5100Class::rxsize_kb[MAX_SOCK_NUM];
+uint8_t  W5100Class::txbase_kb[MAX_SOCK_NUM];
+uint8_t  W5100Class::rxbase_kb[MAX_SOCK_NUM];
 #endif
 W5100Class W5100;
 
@@ -83,6 +89,139 @@ W5100Class W5100;
 #endif
 
 
+/***************************************************/
+/**          AVR pipelined SPI transfers          **/
+/***************************************************/
+
+// SPI.transfer() fetches each byte only after the previous one has
+// finished shifting.  These load the next byte (and store the last
+// one) while the current byte is on the wire, so the only gap between
+// bytes is the SPIF poll.  At 8 MHz a byte takes 16 CPU cycles, which
+// is plenty to hide the loop bookkeeping without unrolling.
+#if defined(__AVR__)
+static inline void spi_wait(void)
+{
+	while (!(SPSR & _BV(SPIF))) ;
+}
+
+static void spi_read_block(uint8_t *buf, uint16_t len)
+{
+	if (len == 0) return;
+	SPDR = 0;
+	while (--len) {
+		spi_wait();
+		uint8_t in = SPDR;
+		SPDR = 0;
+		*buf++ = in;
+	}
+	spi_wait();
+	*buf = SPDR;
+}
+
+static void spi_write_block(const uint8_t *buf, uint16_t len)
+{
+	if (len == 0) return;
+	SPDR = *buf++;
+	while (--len) {
+		uint8_t out = *buf++;
+		spi_wait();
+		SPDR = out;
+	}
+	spi_wait();
+}
+#endif
+
+
+#ifdef ETHERNET_LARGE_BUFFERS
+static uint8_t pow2_floor(uint8_t kb)
+{
+	uint8_t n = 1;
+	if (kb == 0) return 0;
+	while (n <= kb / 2) n <<= 1;
+	return n;
+}
+
+// Share out "total" KB of TX or RX memory over the first "count" sockets.
+// Sizes picked with setBufferSize() are kept and the sockets left at 0
+// split what remains evenly.  Every size is rounded down to a power of
+// two, and the chips place the buffers back to back in socket order, so
+// a socket gets no more than what earlier sockets have left over.  If
+// the picked sizes don't fit together, the largest is halved until they
+// do.
+static void layoutBuffers(uint8_t *size, uint8_t *base, uint8_t count, uint8_t total, uint8_t min_kb)
+{
+	uint8_t i, want, at = 0, asked, others, share, largest;
+
+	for (;;) {
+		asked = 0;
+		others = 0;
+		largest = 0;
+		for (i=0; i < count; i++) {
+			if (size[i]) {
+				size[i] = pow2_floor(size[i] < total ? size[i] : total);
+				asked += size[i];
+				if (size[i] > size[largest] || !size[largest]) largest = i;
+			} else {
+				others++;
+			}
+		}
+		if (asked <= total || size[largest] <= 1) break;
+		size[largest] >>= 1;
+	}
+	share = (others && asked < total) ? pow2_floor((total - asked) / others) : 0;
+	if (share < min_kb) share = min_kb;
+	for (i=0; i < count; i++) {
+		want = size[i] ? size[i] : share;
+		if (want > total - at) want = total - at;
+		size[i] = pow2_floor(want);
+		base[i] = at;
+		at += size[i];
+	}
+	for (; i < MAX_SOCK_NUM; i++) {
+		size[i] = 0;
+		base[i] = at;
+	}
+}
+
+// W5100 TMSR/RMSR: 2 bits per socket, 1K << n
+static uint8_t sizeRegister(const uint8_t *size)
+{
+	uint8_t i, n, reg = 0;
+
+	for (i=0; i < 4 && i < MAX_SOCK_NUM; i++) {
+		for (n=0; n < 3 && (2 << n) <= size[i]; n++) ;
+		reg |= n << (i * 2);
+	}
+	return reg;
+}
+
+// W5500 buffers are addressed by socket (block select) and offset into
+// that socket's buffer
+uint8_t W5100Class::bufferBlock(uint16_t addr, uint16_t &offset)
+{
+	const uint8_t *size, *base;
+	uint8_t s, block;
+
+	if (addr < 0xC000) {
+		size = txsize_kb;
+		base = txbase_kb;
+		addr -= 0x8000;
+		block = 0x10;
+	} else {
+		size = rxsize_kb;
+		base = rxbase_kb;
+		addr -= 0xC000;
+		block = 0x18;
+	}
+	for (s=0; s < MAX_SOCK_NUM - 1; s++) {
+		if ((addr >> 10) < base[s] + size[s]) break;
+	}
+	offset = addr - ((uint16_t)base[s] << 10);
+	return (s << 5) | block;
+}
+#endif
+
+
 uint8_t W5100Class::init(void)
 {
 	static bool initialized = false;
@@ -97,8 +236,10 @@ uint8_t W5100Class::init(void)
 	// a 400 ms worst case maximum pulse length.  MAX811 has a worst
 	// case maximum 560 ms pulse length.  This delay is meant to wait
 	// until the reset pulse is ended.  If your hardware has a shorter
-	// reset time, this can be edited or removed.
-	delay(560);
+	// reset time, define ETHERNET_RESET_WAIT lower.  The pulse starts at
+	// power-up, so only what's left of it once the sketch gets here is
+	// waited out.
+	while (millis() < ETHERNET_RESET_WAIT) ;
 	//Serial.println("w5100 init");
 
 	SPI.begin();
@@ -113,21 +254,18 @@ uint8_t W5100Class::init(void)
 	if (isW5200()) {
 		CH_BASE_MSB = 0x40;
 #ifdef ETHERNET_LARGE_BUFFERS
-#if MAX_SOCK_NUM <= 1
-		SSIZE = 16384;
-#elif MAX_SOCK_NUM <= 2
-		SSIZE = 8192;
-#elif MAX_SOCK_NUM <= 4
-		SSIZE = 4096;
+		layoutBuffers(txsize_kb, txbase_kb, MAX_SOCK_NUM, 16, 0);
+		layoutBuffers(rxsize_kb, rxbase_kb, MAX_SOCK_NUM, 16, 0);
+		for (i=0; i<MAX_SOCK_NUM; i++) {
+			writeSnRX_SIZE(i, rxsize_kb[i]);
+			writeSnTX_SIZE(i, txsize_kb[i]);
+		}
 #else
-		SSIZE = 2048;
-#endif
-		SMASK = SSIZE - 1;
-#endif
 		for (i=0; i<MAX_SOCK_NUM; i++) {
 			writeSnRX_SIZE(i, SSIZE >> 10);
 			writeSnTX_SIZE(i, SSIZE >> 10);
 		}
+#endif
 		for (; i<8; i++) {
 			writeSnRX_SIZE(i, 0);
 			writeSnTX_SIZE(i, 0);
@@ -138,19 +276,11 @@ uint8_t W5100Class::init(void)
 	} else if (isW5500()) {
 		CH_BASE_MSB = 0x10;
 #ifdef ETHERNET_LARGE_BUFFERS
-#if MAX_SOCK_NUM <= 1
-		SSIZE = 16384;
-#elif MAX_SOCK_NUM <= 2
-		SSIZE = 8192;
-#elif MAX_SOCK_NUM <= 4
-		SSIZE = 4096;
-#else
-		SSIZE = 2048;
-#endif
-		SMASK = SSIZE - 1;
+		layoutBuffers(txsize_kb, txbase_kb, MAX_SOCK_NUM, 16, 0);
+		layoutBuffers(rxsize_kb, rxbase_kb, MAX_SOCK_NUM, 16, 0);
 		for (i=0; i<MAX_SOCK_NUM; i++) {
-			writeSnRX_SIZE(i, SSIZE >> 10);
-			writeSnTX_SIZE(i, SSIZE >> 10);
+			writeSnRX_SIZE(i, rxsize_kb[i]);
+			writeSnTX_SIZE(i, txsize_kb[i]);
 		}
 		for (; i<8; i++) {
 			writeSnRX_SIZE(i, 0);
@@ -165,20 +295,12 @@ uint8_t W5100Class::init(void)
 	} else if (isW5100()) {
 		CH_BASE_MSB = 0x04;
 #ifdef ETHERNET_LARGE_BUFFERS
-#if MAX_SOCK_NUM <= 1
-		SSIZE = 8192;
-		writeTMSR(0x03);
-		writeRMSR(0x03);
-#elif MAX_SOCK_NUM <= 2
-		SSIZE = 4096;
-		writeTMSR(0x0A);
-		writeRMSR(0x0A);
-#else
-		SSIZE = 2048;
-		writeTMSR(0x55);
-		writeRMSR(0x55);
-#endif
-		SMASK = SSIZE - 1;
+		// W5100 has no 0 size, every socket takes at least 1K
+		// for as long as there is memory left
+		layoutBuffers(txsize_kb, txbase_kb, MAX_SOCK_NUM < 4 ? MAX_SOCK_NUM : 4, 8, 1);
+		layoutBuffers(rxsize_kb, rxbase_kb, MAX_SOCK_NUM < 4 ? MAX_SOCK_NUM : 4, 8, 1);
+		writeTMSR(sizeRegister(txsize_kb));
+		writeRMSR(sizeRegister(rxsize_kb));
 #else
 		writeTMSR(0x55);
 		writeRMSR(0x55);
@@ -299,11 +421,27 @@ uint16_t W5100Class::write(uint16_t addr, const uint8_t *buf, uint16_t len)
 	if (chip == 51) {
 		for (uint16_t i=0; i<len; i++) {
 			setSS();
+#if defined(__AVR__)
+			// W5100 has no burst mode, every byte is its own 4 byte frame
+			SPDR = 0xF0;
+			uint8_t ah = addr >> 8;
+			uint8_t al = addr & 0xFF;
+			uint8_t data = buf[i];
+			addr++;
+			spi_wait();
+			SPDR = ah;
+			spi_wait();
+			SPDR = al;
+			spi_wait();
+			SPDR = data;
+			spi_wait();
+#else
 			SPI.transfer(0xF0);
 			SPI.transfer(addr >> 8);
 			SPI.transfer(addr & 0xFF);
 			addr++;
 			SPI.transfer(buf[i]);
+#endif
 			resetSS();
 		}
 	} else if (chip == 52) {
@@ -313,7 +451,9 @@ uint16_t W5100Class::write(uint16_t addr, const uint8_t *buf, uint16_t len)
 		cmd[2] = ((len >> 8) & 0x7F) | 0x80;
 		cmd[3] = len & 0xFF;
 		SPI.transfer(cmd, 4);
-#ifdef SPI_HAS_TRANSFER_BUF
+#if defined(__AVR__)
+		spi_write_block(buf, len);
+#elif defined(SPI_HAS_TRANSFER_BUF)
 		SPI.transfer(buf, NULL, len);
 #else
 		// TODO: copy 8 bytes at a time to cmd[] and block transfer
@@ -334,34 +474,28 @@ uint16_t W5100Class::write(uint16_t addr, const uint8_t *buf, uint16_t len)
 			cmd[0] = 0;
 			cmd[1] = addr & 0xFF;
 			cmd[2] = ((addr >> 3) & 0xE0) | 0x0C;
+#ifdef ETHERNET_LARGE_BUFFERS
+		} else {
+			// transmit and receive buffers, sized per socket by init()
+			uint16_t offset;
+			cmd[2] = bufferBlock(addr, offset) | 0x04;
+			cmd[0] = offset >> 8;
+			cmd[1] = offset & 0xFF;
+		}
+#else
 		} else if (addr < 0xC000) {
 			// transmit buffers  8000-87FF, 8800-8FFF, 9000-97FF, etc
 			//  10## #nnn nnnn nnnn
 			cmd[0] = addr >> 8;
 			cmd[1] = addr & 0xFF;
-			#if defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 1
-			cmd[2] = 0x14;                       // 16K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 2
-			cmd[2] = ((addr >> 8) & 0x20) | 0x14; // 8K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 4
-			cmd[2] = ((addr >> 7) & 0x60) | 0x14; // 4K buffers
-			#else
 			cmd[2] = ((addr >> 6) & 0xE0) | 0x14; // 2K buffers
-			#endif
 		} else {
 			// receive buffers
 			cmd[0] = addr >> 8;
 			cmd[1] = addr & 0xFF;
-			#if defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 1
-			cmd[2] = 0x1C;                       // 16K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 2
-			cmd[2] = ((addr >> 8) & 0x20) | 0x1C; // 8K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 4
-			cmd[2] = ((addr >> 7) & 0x60) | 0x1C; // 4K buffers
-			#else
 			cmd[2] = ((addr >> 6) & 0xE0) | 0x1C; // 2K buffers
-			#endif
 		}
+#endif
 		if (len <= 5) {
 			for (uint8_t i=0; i < len; i++) {
 				cmd[i + 3] = buf[i];
@@ -369,7 +503,9 @@ uint16_t W5100Class::write(uint16_t addr, const uint8_t *buf, uint16_t len)
 			SPI.transfer(cmd, len + 3);
 		} else {
 			SPI.transfer(cmd, 3);
-#ifdef SPI_HAS_TRANSFER_BUF
+#if defined(__AVR__)
+			spi_write_block(buf, len);
+#elif defined(SPI_HAS_TRANSFER_BUF)
 			SPI.transfer(buf, NULL, len);
 #else
 			// TODO: copy 8 bytes at a time to cmd[] and block transfer
@@ -390,7 +526,20 @@ uint16_t W5100Class::read(uint16_t addr, uint8_t *buf, uint16_t len)
 	if (chip == 51) {
 		for (uint16_t i=0; i < len; i++) {
 			setSS();
-			#if 1
+			#if defined(__AVR__)
+			SPDR = 0x0F;
+			uint8_t ah = addr >> 8;
+			uint8_t al = addr & 0xFF;
+			addr++;
+			spi_wait();
+			SPDR = ah;
+			spi_wait();
+			SPDR = al;
+			spi_wait();
+			SPDR = 0;
+			spi_wait();
+			buf[i] = SPDR;
+			#elif 1
 			SPI.transfer(0x0F);
 			SPI.transfer(addr >> 8);
 			SPI.transfer(addr & 0xFF);
@@ -414,8 +563,12 @@ uint16_t W5100Class::read(uint16_t addr, uint8_t *buf, uint16_t len)
 		cmd[2] = (len >> 8) & 0x7F;
 		cmd[3] = len & 0xFF;
 		SPI.transfer(cmd, 4);
+#if defined(__AVR__)
+		spi_read_block(buf, len);
+#else
 		memset(buf, 0, len);
 		SPI.transfer(buf, len);
+#endif
 		resetSS();
 	} else { // chip == 55
 		setSS();
@@ -429,37 +582,35 @@ uint16_t W5100Class::read(uint16_t addr, uint8_t *buf, uint16_t len)
 			cmd[0] = 0;
 			cmd[1] = addr & 0xFF;
 			cmd[2] = ((addr >> 3) & 0xE0) | 0x08;
+#ifdef ETHERNET_LARGE_BUFFERS
+		} else {
+			// transmit and receive buffers, sized per socket by init()
+			uint16_t offset;
+			cmd[2] = bufferBlock(addr, offset);
+			cmd[0] = offset >> 8;
+			cmd[1] = offset & 0xFF;
+		}
+#else
 		} else if (addr < 0xC000) {
 			// transmit buffers  8000-87FF, 8800-8FFF, 9000-97FF, etc
 			//  10## #nnn nnnn nnnn
 			cmd[0] = addr >> 8;
 			cmd[1] = addr & 0xFF;
-			#if defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 1
-			cmd[2] = 0x10;                       // 16K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 2
-			cmd[2] = ((addr >> 8) & 0x20) | 0x10; // 8K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 4
-			cmd[2] = ((addr >> 7) & 0x60) | 0x10; // 4K buffers
-			#else
 			cmd[2] = ((addr >> 6) & 0xE0) | 0x10; // 2K buffers
-			#endif
 		} else {
 			// receive buffers
 			cmd[0] = addr >> 8;
 			cmd[1] = addr & 0xFF;
-			#if defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 1
-			cmd[2] = 0x18;                       // 16K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 2
-			cmd[2] = ((addr >> 8) & 0x20) | 0x18; // 8K buffers
-			#elif defined(ETHERNET_LARGE_BUFFERS) && MAX_SOCK_NUM <= 4
-			cmd[2] = ((addr >> 7) & 0x60) | 0x18; // 4K buffers
-			#else
 			cmd[2] = ((addr >> 6) & 0xE0) | 0x18; // 2K buffers
-			#endif
 		}
+#endif
 		SPI.transfer(cmd, 3);
+#if defined(__AVR__)
+		spi_read_block(buf, len);
+#else
 		memset(buf, 0, len);
 		SPI.transfer(buf, len);
+#endif
 		resetSS();
 	}
 	return len;
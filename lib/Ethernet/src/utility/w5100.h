@@ -210,6 +210,9 @@ public:
   __GP_REGISTER8 (VERSIONR_W5500,0x0039);   // Chip Version Register (W5500 only)
   __GP_REGISTER8 (PSTATUS_W5200,     0x0035);    // PHY Status
   __GP_REGISTER8 (PHYCFGR_W5500,     0x002E);    // PHY Configuration register, default: 10111xxx
+  __GP_REGISTER8 (SIMR_W5500,        0x0018);    // Socket Interrupt Mask (W5500 only)
+  __GP_REGISTER8 (IR2_W5200,         0x0034);    // Socket Interrupt (W5200 only)
+  __GP_REGISTER8 (IMR_W5200,         0x0036);    // Socket Interrupt Mask (W5200 only, 0x0016 is IMR2 for IR)
 
 
 #undef __GP_REGISTER8
@@ -283,6 +286,7 @@ public:
   __SOCKET_REGISTER8(SnTTL,       0x0016)        // IP TTL
   __SOCKET_REGISTER8(SnRX_SIZE,   0x001E)        // RX Memory Size (W5200 only)
   __SOCKET_REGISTER8(SnTX_SIZE,   0x001F)        // RX Memory Size (W5200 only)
+  __SOCKET_REGISTER8(SnIMR,       0x002C)        // Interrupt Mask (W5200 and W5500 only)
   __SOCKET_REGISTER16(SnTX_FSR,   0x0020)        // TX Free Size
   __SOCKET_REGISTER16(SnTX_RD,    0x0022)        // TX Read Pointer
   __SOCKET_REGISTER16(SnTX_WR,    0x0024)        // TX Write Pointer
@@ -306,12 +310,45 @@ private:
 public:
   static uint8_t getChip(void) { return chip; }
 #ifdef ETHERNET_LARGE_BUFFERS
-  static uint16_t SSIZE;
-  static uint16_t SMASK;
+  // Each socket's buffer size can be picked with setBufferSize() before
+  // init().  Sockets left at 0 share out whatever memory remains.
+  static void setBufferSize(uint8_t socknum, uint8_t rx_kb, uint8_t tx_kb) {
+    rxsize_kb[socknum] = rx_kb;
+    txsize_kb[socknum] = tx_kb;
+  }
+  static uint16_t TXSIZE(uint8_t socknum) { return (uint16_t)txsize_kb[socknum] << 10; }
+  static uint16_t RXSIZE(uint8_t socknum) { return (uint16_t)rxsize_kb[socknum] << 10; }
+  static uint16_t TXMASK(uint8_t socknum) { return TXSIZE(socknum) - 1; }
+  static uint16_t RXMASK(uint8_t socknum) { return RXSIZE(socknum) - 1; }
+  static uint16_t SBASE(uint8_t socknum) {
+    if (chip == 51) {
+      return ((uint16_t)txbase_kb[socknum] << 10) + 0x4000;
+    } else {
+      return ((uint16_t)txbase_kb[socknum] << 10) + 0x8000;
+    }
+  }
+  static uint16_t RBASE(uint8_t socknum) {
+    if (chip == 51) {
+      return ((uint16_t)rxbase_kb[socknum] << 10) + 0x6000;
+    } else {
+      return ((uint16_t)rxbase_kb[socknum] << 10) + 0xC000;
+    }
+  }
+private:
+  // buffer sizes and offsets within the chip's TX and RX memory, in KB
+  static uint8_t txsize_kb[MAX_SOCK_NUM];
+  static uint8_t rxsize_kb[MAX_SOCK_NUM];
+  static uint8_t txbase_kb[MAX_SOCK_NUM];
+  static uint8_t rxbase_kb[MAX_SOCK_NUM];
+  static uint8_t bufferBlock(uint16_t addr, uint16_t &offset);
+public:
 #else
   static const uint16_t SSIZE = 2048;
   static const uint16_t SMASK = 0x07FF;
-#endif
+  static uint16_t TXSIZE(uint8_t socknum) { return SSIZE; }
+  static uint16_t RXSIZE(uint8_t socknum) { return SSIZE; }
+  static uint16_t TXMASK(uint8_t socknum) { return SMASK; }
+  static uint16_t RXMASK(uint8_t socknum) { return SMASK; }
   static uint16_t SBASE(uint8_t socknum) {
     if (chip == 51) {
       return socknum * SSIZE + 0x4000;
@@ -326,6 +363,7 @@ public:
       return socknum * SSIZE + 0xC000;
     }
   }
+#endif
 
   static bool hasOffsetAddressMapping(void) {
     if (chip == 55) return true;
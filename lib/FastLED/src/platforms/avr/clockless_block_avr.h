@@ -0,0 +1,133 @@
+#ifndef __INC_CLOCKLESS_BLOCK_AVR_H
+#define __INC_CLOCKLESS_BLOCK_AVR_H
+
+// Parallel clockless output for the ATmega1280/2560: up to 8 strips on PORTA
+// (pins 22-29), all clocked out by the same port writes, so a frame takes as
+// long as one strip's share of the LEDs.  See clockless.h for detailed info
+// on how the template parameters are used.
+//
+// There is no time to load, scale and transpose pixels with 8 lanes inside a
+// ~20 cycle bit, so this controller works differently from the trinket one:
+//  - every bit is one byte written to the whole port.  Its bit n is lane n's
+//    data bit, built one lane at a time (lsl lane / rol byte) while the
+//    previous bit is going out - an 8x1 transposition spread over the 8 bits
+//  - the 8 lane bytes of the next colour byte are read in the low part of
+//    each byte's last bit, which is stretched to ~3.2us.  WS281x parts
+//    latch after ~6us low, so this is safe, but it is not in the datasheet
+//  - brightness, colour correction and dithering are not applied: the LED
+//    data is sent as is
+//  - interrupts are off for the whole frame, and millis() is moved on
+//    afterwards
+//  - all 8 bits of PORTA are written, so the pins above the last lane are
+//    driven low
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define FASTLED_HAS_BLOCKLESS 1
+
+#define PORTA_FIRST_PIN 22
+
+#define AVR_BLOCK_LANES(L) ((L) < 8 ? (L) : 8)
+#define AVR_BLOCK_MASK(L) ((1 << AVR_BLOCK_LANES(L)) - 1)
+
+// One bit of every lane, see above
+#define _PB_HI   "out %[port], %[hi]\n\t"
+#define _PB_DATA "out %[port], %[cur]\n\t"
+#define _PB_LO   "out %[port], __zero_reg__\n\t"
+#define _PB_NEXT "mov %[cur], %[nx]\n\t"
+#define _PB_WAIT(D) ".rept %[" #D "]\n\tnop\n\t.endr\n\t"
+#define _PB_BIT(L) "lsl %[" #L "]\n\trol %[nx]\n\t"
+#define _PB_BITS8 _PB_BIT(l7) _PB_BIT(l6) _PB_BIT(l5) _PB_BIT(l4) _PB_BIT(l3) _PB_BIT(l2) _PB_BIT(l1) _PB_BIT(l0)
+
+// Lane bytes are a strip's length apart
+#define _PB_LOAD(L) "ld %[" #L "], %a[ptr]\n\tadd %A[ptr], %A[stride]\n\tadc %B[ptr], %B[stride]\n\t"
+#define _PB_LOADIF(N, L) ".if %[lanes] > " #N "\n\t" _PB_LOAD(L) ".endif\n\t"
+#define _PB_LOADS _PB_LOADIF(2, l2) _PB_LOADIF(3, l3) _PB_LOADIF(4, l4) _PB_LOADIF(5, l5) _PB_LOADIF(6, l6) _PB_LOADIF(7, l7) \
+	"sub %A[ptr], %A[rewind]\n\tsbc %B[ptr], %B[rewind]\n\t"
+
+// Move to the next colour byte of the pixel (D is -2..2)
+#define _PB_MOVE(D) ".if %[" #D "] > 0\n\tadiw %[ptr], %[" #D "]\n\t.elseif %[" #D "] < 0\n\tsbiw %[ptr], -%[" #D "]\n\t.else\n\trjmp .+0\n\t.endif\n\t"
+#define _PB_MOVE_PIXEL "add %A[ptr], %A[pixel]\n\tadc %B[ptr], %B[pixel]\n\t"
+
+// T1+T2+T3 cycles: 8 lane bits are shifted into the next port byte around the three writes
+#define _PB_SLOT _PB_HI _PB_BIT(l7) _PB_BIT(l6) _PB_WAIT(d1) _PB_DATA _PB_BIT(l5) _PB_BIT(l4) _PB_WAIT(d2) \
+	_PB_LO _PB_BIT(l3) _PB_BIT(l2) _PB_BIT(l1) _PB_BIT(l0) _PB_NEXT _PB_WAIT(d3)
+// The last bit of a colour byte reads the lanes' next byte and starts on it
+#define _PB_LOADSLOT(MOVE) _PB_HI _PB_LOAD(l0) _PB_WAIT(d1) _PB_DATA _PB_LOAD(l1) _PB_WAIT(d2) \
+	_PB_LO _PB_LOADS MOVE _PB_BITS8 _PB_NEXT
+#define _PB_BYTE(MOVE) _PB_SLOT _PB_SLOT _PB_SLOT _PB_SLOT _PB_SLOT _PB_SLOT _PB_SLOT _PB_LOADSLOT(MOVE)
+
+// extra cycles in a byte's last bit with 8 lanes (loads, rewind, move), for the millis() catch-up
+#define _PB_LOAD_CLKS 36
+
+FASTLED_NAMESPACE_BEGIN
+
+template <uint8_t LANES, int FIRST_PIN, int T1, int T2, int T3, EOrder RGB_ORDER = GRB, int XTRA0 = 0, bool FLIP = false, int WAIT_TIME = 50>
+class InlineBlockClocklessController : public CPixelLEDController<RGB_ORDER, LANES, AVR_BLOCK_MASK(LANES)> {
+	static_assert(LANES >= 2, "Use a single pin controller for one strip");
+	static_assert(T1 >= 5 && T2 >= 5 && T3 >= 10, "Not enough cycles - use a higher clock speed");
+
+	CMinWait<WAIT_TIME> mWait;
+
+public:
+	virtual int size() { return CLEDController::size() * LANES; }
+
+	virtual void init() {
+		for (uint8_t i = 0; i < AVR_BLOCK_LANES(LANES); ++i) {
+			pinMode(FIRST_PIN + i, OUTPUT);
+		}
+	}
+
+	virtual uint16_t getMaxRefreshRate() const { return 400; }
+
+	virtual void showPixels(PixelController<RGB_ORDER, LANES, AVR_BLOCK_MASK(LANES)> & pixels) {
+		mWait.wait();
+		cli();
+		if (pixels.mLen > 0) {
+			showRGBInternal(pixels);
+		}
+
+		// Timer0 overflows were missed while interrupts were off
+		uint32_t clocks = (uint32_t)pixels.mLen * (24 * (T1 + T2 + T3) + 3 * _PB_LOAD_CLKS);
+		MS_COUNTER += (clocks / (F_CPU / 1000000L)) / 1000;
+		sei();
+		mWait.mark();
+	}
+
+	static void showRGBInternal(PixelController<RGB_ORDER, LANES, AVR_BLOCK_MASK(LANES)> & pixels) {
+		const uint8_t *ptr = pixels.mData + RGB_BYTE0(RGB_ORDER);
+		uint16_t stride = pixels.mOffsets[1];
+		uint16_t rewind = stride * AVR_BLOCK_LANES(LANES);
+		uint16_t pixel = pixels.mAdvance + RGB_BYTE0(RGB_ORDER) - RGB_BYTE2(RGB_ORDER);
+		uint16_t count = pixels.mLen;
+		uint8_t l0 = 0, l1 = 0, l2 = 0, l3 = 0, l4 = 0, l5 = 0, l6 = 0, l7 = 0;
+		uint8_t cur = 0, nx;
+
+		// The last pixel reads one pixel past the end of the data, which is never sent
+		asm __volatile__(
+			_PB_LOAD(l0) _PB_LOAD(l1) _PB_LOADS _PB_MOVE(d01) _PB_BITS8 _PB_NEXT
+			"1:\n\t"
+			_PB_BYTE(_PB_MOVE(d12))
+			_PB_BYTE(_PB_MOVE_PIXEL)
+			_PB_BYTE(_PB_MOVE(d01))
+			"sbiw %[count], 1\n\t"
+			"breq 2f\n\t"
+			"rjmp 1b\n\t"
+			"2:\n\t"
+			: [l0] "+r" (l0), [l1] "+r" (l1), [l2] "+r" (l2), [l3] "+r" (l3),
+			  [l4] "+r" (l4), [l5] "+r" (l5), [l6] "+r" (l6), [l7] "+r" (l7),
+			  [cur] "+r" (cur), [nx] "=&r" (nx), [ptr] "+z" (ptr), [count] "+w" (count)
+			: [port] "M" (FastPin<FIRST_PIN>::port() - 0x20), [hi] "r" ((uint8_t)AVR_BLOCK_MASK(LANES)),
+			  [stride] "r" (stride), [rewind] "r" (rewind), [pixel] "r" (pixel),
+			  [lanes] "n" (AVR_BLOCK_LANES(LANES)),
+			  [d01] "n" (RGB_BYTE1(RGB_ORDER) - RGB_BYTE0(RGB_ORDER)),
+			  [d12] "n" (RGB_BYTE2(RGB_ORDER) - RGB_BYTE1(RGB_ORDER)),
+			  [d1] "n" (T1 - 5), [d2] "n" (T2 - 5), [d3] "n" (T3 - 10)
+			: "cc", "memory"
+		);
+	}
+};
+
+FASTLED_NAMESPACE_END
+
+#endif
+
+#endif
@@ -74,6 +74,11 @@ uint32_t calculate_unscaled_power_mW( const CRGB* ledbuffer, uint16_t numLeds )
         --count;
     }
 
+    return calculate_unscaled_power_mW( red32, green32, blue32, numLeds);
+}
+
+uint32_t calculate_unscaled_power_mW( uint32_t red32, uint32_t green32, uint32_t blue32, uint16_t numLeds )
+{
     red32   *= gRed_mW;
     green32 *= gGreen_mW;
     blue32  *= gBlue_mW;
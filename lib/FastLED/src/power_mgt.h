@@ -67,6 +67,16 @@ void delay_at_max_brightness_for_power( uint16_t ms);
 /// @returns the number of milliwatts the LED data would consume at max brightness
 uint32_t calculate_unscaled_power_mW( const CRGB* ledbuffer, uint16_t numLeds);
 
+/// @copybrief calculate_unscaled_power_mW(const CRGB*, uint16_t)
+/// For callers that already keep per-channel totals of their LED data, e.g.
+/// while copying it in, and don't want a second pass over it.
+/// @param red the sum of the red values of all the LEDs
+/// @param green the sum of the green values of all the LEDs
+/// @param blue the sum of the blue values of all the LEDs
+/// @param numLeds the number of LEDs summed
+/// @returns the number of milliwatts those LEDs would consume at max brightness
+uint32_t calculate_unscaled_power_mW( uint32_t red, uint32_t green, uint32_t blue, uint16_t numLeds);
+
 /// Determines the highest brightness level you can use and still stay under
 /// the specified power budget for a given set of LEDs.
 /// @param ledbuffer the LED data to check
@@ -0,0 +1,33 @@
+// Hot-path trace, see Trace.h
+// by Miles Punch
+
+// All Rights Reserved 2025
+// Licensed under the GNU GPL License.
+
+#include "Trace.h"
+
+#if TRACE
+TraceRecord traceRing[TRACE_DEPTH];
+uint8_t traceHead   = 0;
+uint16_t traceCount = 0;
+uint32_t traceSkew  = 0;
+
+void trace_dump(Print& out) {
+    uint8_t i = (traceHead - traceCount) & (TRACE_DEPTH - 1);
+
+    out.write((const uint8_t*)TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    out.write((uint8_t)traceCount);
+    out.write((uint8_t)(traceCount >> 8));
+    while (traceCount) {
+        const TraceRecord& r = traceRing[i];
+        uint8_t record[TRACE_RECORD_SIZE] = {(uint8_t)r.time, (uint8_t)(r.time >> 8), (uint8_t)(r.time >> 16),
+                                             (uint8_t)(r.time >> 24), r.event, r.arg};
+        out.write(record, TRACE_RECORD_SIZE);
+        i = (i + 1) & (TRACE_DEPTH - 1);
+        traceCount--;
+    }
+
+    // The time spent writing shows up as a gap in the next dump
+    trace_event(TRACE_DUMP, 0);
+}
+#endif
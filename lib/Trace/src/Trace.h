@@ -0,0 +1,100 @@
+// Hot-path trace
+// by Miles Punch
+
+// All Rights Reserved 2025
+// Licensed under the GNU GPL License.
+
+// Events and micros() timestamps recorded into a ring buffer in SRAM, to be
+// dumped on request and turned into a timeline by tools/trace_decode.
+//
+// TRACE must come from build_flags, not main.h, since the Ethernet library
+// is compiled on its own and records too. With TRACE 0 the macros below
+// compile to nothing. Events are only recorded from loop(), never from
+// interrupt handlers, so no locking is needed.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#ifndef TRACE
+#define TRACE 0  // 1: record hot-path events, 0: no tracing
+#endif
+#ifndef TRACE_DEPTH
+#define TRACE_DEPTH 64  // events kept, a power of two up to 256 (6 bytes each on AVR)
+#endif
+
+// Event IDs. Each step of the hot path is a BEGIN/END pair, with the END
+// having TRACE_END set so that the decoder can match them up.
+#define TRACE_END 0x80
+enum TraceEventId : uint8_t {
+    TRACE_PARSE    = 1,  // Receiver_::parseNext() of a packet; END arg: OpCode high byte
+    TRACE_RECV     = 2,  // EthernetClass::socketRecv(); arg: socket
+    TRACE_CALLBACK = 3,  // artnet_callback(); arg: universe, relative to START_UNIVERSE
+    TRACE_SHOW     = 4,  // FastLED.show() or a universe's showLeds(); arg: universes received
+    TRACE_DUMP     = 5,  // a dump was written out just before this (single event)
+};
+
+// Dump format, all little-endian: TRACE_MAGIC, then a uint16 count of the
+// events that follow, oldest first, each a uint32 timestamp in µs, the
+// event ID and its arg.
+#define TRACE_MAGIC       "TRC1"
+#define TRACE_MAGIC_SIZE  4
+#define TRACE_RECORD_SIZE 6
+
+#if TRACE
+#include <Arduino.h>
+
+#if TRACE_DEPTH < 2 || TRACE_DEPTH > 256 || (TRACE_DEPTH & (TRACE_DEPTH - 1))
+#error "TRACE_DEPTH must be a power of two from 2 to 256"
+#endif
+
+struct TraceRecord {
+    uint32_t time;
+    uint8_t event;
+    uint8_t arg;
+};
+
+extern TraceRecord traceRing[TRACE_DEPTH];
+extern uint8_t traceHead;    // where the next event goes
+extern uint16_t traceCount;  // events recorded since the last dump, up to TRACE_DEPTH
+extern uint32_t traceSkew;   // µs micros() has missed, added to every timestamp
+
+static inline void trace_event(uint8_t event, uint8_t arg) {
+    TraceRecord& r = traceRing[traceHead];
+    r.time         = micros() + traceSkew;
+    r.event        = event;
+    r.arg          = arg;
+    traceHead      = (traceHead + 1) & (TRACE_DEPTH - 1);
+    if (traceCount < TRACE_DEPTH)
+        traceCount++;
+}
+
+// BEGIN now and END when it goes out of scope, for functions with many returns
+struct TraceScope {
+    uint8_t event;
+    uint8_t arg;
+    TraceScope(uint8_t event, uint8_t arg) : event(event), arg(arg) {
+        trace_event(event, arg);
+    }
+    ~TraceScope() {
+        trace_event(event | TRACE_END, arg);
+    }
+};
+
+// Write the events recorded since the last dump to out, and start over
+void trace_dump(Print& out);
+
+#define TRACE_BEGIN(event, arg)  trace_event((event), (uint8_t)(arg))
+#define TRACE_FINISH(event, arg) trace_event((event) | TRACE_END, (uint8_t)(arg))
+#define TRACE_SCOPE(event, arg)  TraceScope traceScope((event), (uint8_t)(arg))
+// micros() stood still for us µs: AVR shows run with interrupts off
+#define TRACE_MISSED(us) (traceSkew += (us))
+#else
+#define TRACE_BEGIN(event, arg)
+#define TRACE_FINISH(event, arg)
+#define TRACE_SCOPE(event, arg)
+#define TRACE_MISSED(us)
+#endif
+
+#endif  // TRACE_H
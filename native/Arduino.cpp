@@ -0,0 +1,18 @@
+// Arduino core stand-in for the `native` environment, see Arduino.h.
+
+#include "Arduino.h"
+
+#include <poll.h>
+#include <unistd.h>
+
+NativeSerial_ NativeSerial;
+
+int NativeSerial_::available() {
+    pollfd in = {STDIN_FILENO, POLLIN, 0};
+    return poll(&in, 1, 0) == 1 && (in.revents & POLLIN) ? 1 : 0;
+}
+
+int NativeSerial_::read() {
+    uint8_t c;
+    return available() && ::read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
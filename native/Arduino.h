@@ -0,0 +1,50 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Arduino core stand-in for the `native` environment.
+//
+// FastLED's stub platform already provides timing, pin and Serial emulation;
+// this header adds the handful of core classes (String, Print, IPAddress, UDP)
+// that the ArtNet and Ethernet APIs are written against.
+
+#include "platforms/stub/Arduino.h"
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "WString.h"
+
+// FastLED's SerialEmulation only knows a few print overloads; route the
+// sketch's Serial through Print so DEBUG builds format like on the board.
+// Serial input is read from stdin, without blocking.
+class NativeSerial_ : public Print {
+public:
+    void begin(unsigned long) {}
+    int available();
+    int read();
+    size_t write(uint8_t c) override {
+        return fwrite(&c, 1, 1, stdout);
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        return fwrite(buffer, 1, size, stdout);
+    }
+    using Print::write;
+};
+extern NativeSerial_ NativeSerial;
+#define Serial NativeSerial
+
+// Program memory is plain memory here
+#ifndef PSTR
+#define PSTR(s) (s)
+#endif
+#ifndef snprintf_P
+#define snprintf_P snprintf
+#endif
+
+#ifndef DEC
+#define DEC 10
+#endif
+#ifndef HEX
+#define HEX 16
+#endif
+
+#endif  // NATIVE_ARDUINO_H
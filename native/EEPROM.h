@@ -0,0 +1,45 @@
+#ifndef NATIVE_EEPROM_H
+#define NATIVE_EEPROM_H
+
+// EEPROM stand-in for the `native` environment: 4 KB of RAM, erased (0xFF)
+// at start-up like a fresh chip, so nothing survives between runs.
+
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass {
+public:
+    EEPROMClass() {
+        memset(_data, 0xFF, sizeof(_data));
+    }
+    uint8_t read(int idx) {
+        return _data[idx];
+    }
+    void write(int idx, uint8_t val) {
+        _data[idx] = val;
+    }
+    void update(int idx, uint8_t val) {
+        _data[idx] = val;
+    }
+    uint16_t length() {
+        return sizeof(_data);
+    }
+
+    template <typename T>
+    T& get(int idx, T& t) {
+        memcpy(&t, _data + idx, sizeof(T));
+        return t;
+    }
+    template <typename T>
+    const T& put(int idx, const T& t) {
+        memcpy(_data + idx, &t, sizeof(T));
+        return t;
+    }
+
+private:
+    uint8_t _data[4096];
+};
+
+static EEPROMClass EEPROM;
+
+#endif  // NATIVE_EEPROM_H
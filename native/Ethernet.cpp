@@ -0,0 +1,204 @@
+// Host stand-in for the Arduino Ethernet library, see Ethernet.h.
+
+#include "Ethernet.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+EthernetClass Ethernet;
+
+uint8_t EthernetClass::_mac[6];
+IPAddress EthernetClass::_localIP(127, 0, 0, 1);
+IPAddress EthernetClass::_subnetMask(255, 0, 0, 0);
+IPAddress EthernetClass::_gatewayIP(127, 0, 0, 1);
+IPAddress EthernetClass::_dnsServerIP(127, 0, 0, 1);
+bool EthernetClass::_dhcpPending = false;
+
+int EthernetClass::begin(uint8_t* mac, unsigned long timeout, unsigned long responseTimeout) {
+    (void)timeout;
+    (void)responseTimeout;
+    // There's no DHCP server to ask; the loopback configuration stands in for a lease.
+    memcpy(_mac, mac, 6);
+    return 1;
+}
+
+int EthernetClass::beginDHCP(uint8_t* mac, IPAddress ip, IPAddress subnet, IPAddress gateway, unsigned long responseTimeout) {
+    (void)ip;
+    (void)subnet;
+    (void)gateway;
+    (void)responseTimeout;
+    memcpy(_mac, mac, 6);
+    _dhcpPending = true;
+    return 1;
+}
+
+int EthernetClass::maintainDHCP() {
+    // The loopback configuration is "leased" on the first poll.
+    if (!_dhcpPending)
+        return DHCP_POLL_WAITING;
+    _dhcpPending = false;
+    return DHCP_POLL_LEASED;
+}
+
+void EthernetClass::begin(uint8_t* mac, IPAddress ip) {
+    IPAddress dns = ip;
+    dns[3]        = 1;
+    begin(mac, ip, dns);
+}
+
+void EthernetClass::begin(uint8_t* mac, IPAddress ip, IPAddress dns) {
+    IPAddress gateway = ip;
+    gateway[3]        = 1;
+    begin(mac, ip, dns, gateway);
+}
+
+void EthernetClass::begin(uint8_t* mac, IPAddress ip, IPAddress dns, IPAddress gateway) {
+    begin(mac, ip, dns, gateway, IPAddress(255, 255, 255, 0));
+}
+
+void EthernetClass::begin(uint8_t* mac, IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet) {
+    memcpy(_mac, mac, 6);
+    // The static address is recorded for localIP(), but sockets still bind to
+    // every host interface so loopback senders reach us.
+    _localIP     = ip;
+    _dnsServerIP = dns;
+    _gatewayIP   = gateway;
+    _subnetMask  = subnet;
+}
+
+void EthernetClass::MACAddress(uint8_t* mac_address) {
+    memcpy(mac_address, _mac, 6);
+}
+
+uint8_t EthernetUDP::begin(uint16_t port) {
+    stop();
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return 0;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(port);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        stop();
+        return 0;
+    }
+
+    _port      = port;
+    _remaining = 0;
+    return 1;
+}
+
+void EthernetUDP::stop() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    _remaining = 0;
+}
+
+int EthernetUDP::beginPacket(IPAddress ip, uint16_t port) {
+    if ((uint32_t)ip == 0 || port == 0)
+        return 0;
+    _txIP     = ip;
+    _txPort   = port;
+    _txLength = 0;
+    return 1;
+}
+
+int EthernetUDP::beginPacket(const char* host, uint16_t port) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res)
+        return 0;
+    IPAddress ip((uint32_t)((sockaddr_in*)res->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(res);
+    return beginPacket(ip, port);
+}
+
+int EthernetUDP::endPacket() {
+    if (fd < 0)
+        return 0;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = (uint32_t)_txIP;
+    addr.sin_port        = htons(_txPort);
+    ssize_t sent         = sendto(fd, _txBuffer, _txLength, 0, (sockaddr*)&addr, sizeof(addr));
+    _txLength            = 0;
+    return sent >= 0 ? 1 : 0;
+}
+
+size_t EthernetUDP::write(uint8_t byte) {
+    return write(&byte, 1);
+}
+
+size_t EthernetUDP::write(const uint8_t* buffer, size_t size) {
+    if (size > (size_t)(sizeof(_txBuffer) - _txLength))
+        size = sizeof(_txBuffer) - _txLength;
+    memcpy(_txBuffer + _txLength, buffer, size);
+    _txLength += size;
+    return size;
+}
+
+int EthernetUDP::parsePacket() {
+    // discard any remaining bytes in the last packet
+    _remaining = 0;
+    if (fd < 0)
+        return 0;
+
+    sockaddr_in from;
+    socklen_t fromlen = sizeof(from);
+    ssize_t got       = recvfrom(fd, _rxBuffer, sizeof(_rxBuffer), MSG_DONTWAIT, (sockaddr*)&from, &fromlen);
+    if (got <= 0)
+        return 0;
+
+    _remoteIP   = IPAddress((uint32_t)from.sin_addr.s_addr);
+    _remotePort = ntohs(from.sin_port);
+    _remaining  = (uint16_t)got;
+    _rxOffset   = 0;
+    return _remaining;
+}
+
+int EthernetUDP::read() {
+    if (_remaining == 0)
+        return -1;
+    _remaining--;
+    return _rxBuffer[_rxOffset++];
+}
+
+int EthernetUDP::read(unsigned char* buffer, size_t len) {
+    if (_remaining == 0)
+        return -1;
+    if (len > _remaining)
+        len = _remaining;
+    if (buffer)
+        memcpy(buffer, _rxBuffer + _rxOffset, len);
+    _rxOffset += len;
+    _remaining -= len;
+    return (int)len;
+}
+
+int EthernetUDP::peek() {
+    if (_remaining == 0)
+        return -1;
+    return _rxBuffer[_rxOffset];
+}
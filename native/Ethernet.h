@@ -0,0 +1,156 @@
+#ifndef ethernet_h_
+#define ethernet_h_
+
+// Host stand-in for the Arduino Ethernet library used by the `native`
+// environment. EthernetClass reports a fixed loopback configuration and
+// EthernetUDP is a non-blocking POSIX datagram socket, so the firmware's
+// receive path runs unchanged against real UDP traffic on this machine.
+
+#include <Arduino.h>
+
+#include "Udp.h"
+
+#define MAX_SOCK_NUM 4
+
+enum EthernetLinkStatus {
+    Unknown,
+    LinkON,
+    LinkOFF
+};
+
+enum EthernetHardwareStatus {
+    EthernetNoHardware,
+    EthernetW5100,
+    EthernetW5200,
+    EthernetW5500
+};
+
+// maintainDHCP() results
+#define DHCP_POLL_WAITING 0
+#define DHCP_POLL_LEASED  1
+#define DHCP_POLL_REFUSED 2
+
+class EthernetClass {
+public:
+    static int begin(uint8_t* mac, unsigned long timeout = 60000, unsigned long responseTimeout = 4000);
+    static int maintain() {
+        return 0;
+    }
+    static int beginDHCP(uint8_t* mac, IPAddress ip = IPAddress(0, 0, 0, 0), IPAddress subnet = IPAddress(0, 0, 0, 0),
+                         IPAddress gateway = IPAddress(0, 0, 0, 0), unsigned long responseTimeout = 4000);
+    static int maintainDHCP();
+    static EthernetLinkStatus linkStatus() {
+        return LinkON;
+    }
+    static EthernetHardwareStatus hardwareStatus() {
+        return EthernetW5500;
+    }
+
+    static void begin(uint8_t* mac, IPAddress ip);
+    static void begin(uint8_t* mac, IPAddress ip, IPAddress dns);
+    static void begin(uint8_t* mac, IPAddress ip, IPAddress dns, IPAddress gateway);
+    static void begin(uint8_t* mac, IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet);
+    static void init(uint8_t sspin = 10) {
+        (void)sspin;
+    }
+
+    static void MACAddress(uint8_t* mac_address);
+    static IPAddress localIP() {
+        return _localIP;
+    }
+    static IPAddress subnetMask() {
+        return _subnetMask;
+    }
+    static IPAddress gatewayIP() {
+        return _gatewayIP;
+    }
+    static IPAddress dnsServerIP() {
+        return _dnsServerIP;
+    }
+
+    // There is no INT pin on the host; the socket is always polled
+    static void enableRecvInterrupt() {}
+    static void clearRecvInterrupt() {}
+    static void setSocketBufferSize(uint8_t, uint8_t, uint8_t = 0) {}
+
+private:
+    static uint8_t _mac[6];
+    static IPAddress _localIP;
+    static IPAddress _subnetMask;
+    static IPAddress _gatewayIP;
+    static IPAddress _dnsServerIP;
+    static bool _dhcpPending;
+};
+
+extern EthernetClass Ethernet;
+
+#define UDP_TX_PACKET_MAX_SIZE 24
+
+class EthernetUDP : public UDP {
+public:
+    // Largest datagram we accept; anything longer is truncated by the kernel.
+    static const uint16_t RX_BUFFER_SIZE = 1500;
+
+    EthernetUDP() : fd(-1), _port(0), _remotePort(0), _remaining(0), _rxOffset(0), _txPort(0), _txLength(0) {}
+    virtual ~EthernetUDP() {
+        stop();
+    }
+
+    virtual uint8_t begin(uint16_t port);
+    virtual void stop();
+
+    virtual int beginPacket(IPAddress ip, uint16_t port);
+    virtual int beginPacket(const char* host, uint16_t port);
+    virtual int endPacket();
+    virtual size_t write(uint8_t);
+    virtual size_t write(const uint8_t* buffer, size_t size);
+
+    using Print::write;
+
+    virtual int parsePacket();
+    virtual int available() {
+        return _remaining;
+    }
+    virtual int read();
+    virtual int read(unsigned char* buffer, size_t len);
+    virtual int read(char* buffer, size_t len) {
+        return read((unsigned char*)buffer, len);
+    }
+    virtual int peek();
+    virtual void flush() {}
+
+    // The kernel queues datagrams on its own, so there is nothing to defer
+    int beginBatch() {
+        return 0;
+    }
+    void endBatch() {}
+    unsigned long overruns() const {
+        return 0;
+    }
+
+    virtual IPAddress remoteIP() {
+        return _remoteIP;
+    }
+    virtual uint16_t remotePort() {
+        return _remotePort;
+    }
+    virtual uint16_t localPort() {
+        return _port;
+    }
+
+private:
+    int fd;
+    uint16_t _port;
+    IPAddress _remoteIP;
+    uint16_t _remotePort;
+    uint16_t _remaining;
+    uint16_t _rxOffset;
+    uint8_t _rxBuffer[RX_BUFFER_SIZE];
+
+    IPAddress _txIP;
+    uint16_t _txPort;
+    uint16_t _txLength;
+    uint8_t _txBuffer[RX_BUFFER_SIZE];
+};
+
+#endif  // ethernet_h_
@@ -0,0 +1 @@
+#include "Ethernet.h"
@@ -0,0 +1,56 @@
+#ifndef NATIVE_IPADDRESS_H
+#define NATIVE_IPADDRESS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "WString.h"
+
+// IPv4 address with the Arduino core layout: four bytes in network order.
+class IPAddress {
+public:
+    IPAddress() : bytes{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+    IPAddress(uint32_t address) {
+        memcpy(bytes, &address, 4);
+    }
+    IPAddress(const uint8_t* address) {
+        memcpy(bytes, address, 4);
+    }
+
+    operator uint32_t() const {
+        uint32_t v;
+        memcpy(&v, bytes, 4);
+        return v;
+    }
+    bool operator==(const IPAddress& rhs) const {
+        return memcmp(bytes, rhs.bytes, 4) == 0;
+    }
+    bool operator!=(const IPAddress& rhs) const {
+        return !(*this == rhs);
+    }
+    uint8_t operator[](int index) const {
+        return bytes[index];
+    }
+    uint8_t& operator[](int index) {
+        return bytes[index];
+    }
+    IPAddress& operator=(const uint8_t* address) {
+        memcpy(bytes, address, 4);
+        return *this;
+    }
+
+    uint8_t* raw_address() {
+        return bytes;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t bytes[4];
+};
+
+#endif  // NATIVE_IPADDRESS_H
@@ -0,0 +1,88 @@
+#ifndef NATIVE_PRINT_H
+#define NATIVE_PRINT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "IPAddress.h"
+#include "WString.h"
+
+// Arduino Print base class. Numeric formatting is done with snprintf and
+// funnelled through write(), same contract as the AVR core.
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+    size_t write(const char* str) {
+        return str ? write((const uint8_t*)str, strlen(str)) : 0;
+    }
+    size_t write(const char* buffer, size_t size) {
+        return write((const uint8_t*)buffer, size);
+    }
+
+    size_t print(const char* s) {
+        return write(s);
+    }
+    size_t print(const String& s) {
+        return write(s.c_str(), s.length());
+    }
+    size_t print(char c) {
+        return write((uint8_t)c);
+    }
+    size_t print(long v, int base = 10) {
+        return printf_(base == 16 ? "%lX" : "%ld", v);
+    }
+    size_t print(unsigned long v, int base = 10) {
+        return printf_(base == 16 ? "%lX" : "%lu", v);
+    }
+    size_t print(int v, int base = 10) {
+        return print((long)v, base);
+    }
+    size_t print(unsigned int v, int base = 10) {
+        return print((unsigned long)v, base);
+    }
+    size_t print(unsigned char v, int base = 10) {
+        return print((unsigned long)v, base);
+    }
+    size_t print(const IPAddress& ip) {
+        return print(ip.toString());
+    }
+    size_t print(double v, int digits = 2) {
+        char fmt[8];
+        snprintf(fmt, sizeof(fmt), "%%.%df", digits);
+        return printf_(fmt, v);
+    }
+
+    size_t println() {
+        return write("\r\n");
+    }
+    template <typename T>
+    size_t println(const T& v) {
+        size_t n = print(v);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T& v, int fmt) {
+        size_t n = print(v, fmt);
+        return n + println();
+    }
+
+private:
+    template <typename T>
+    size_t printf_(const char* fmt, T v) {
+        char buf[48];
+        int n = snprintf(buf, sizeof(buf), fmt, v);
+        return n > 0 ? write(buf, (size_t)n) : 0;
+    }
+};
+
+#endif  // NATIVE_PRINT_H
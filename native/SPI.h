@@ -0,0 +1,7 @@
+#ifndef NATIVE_SPI_H
+#define NATIVE_SPI_H
+
+// The native build has no SPI bus; the Ethernet stand-in talks to the host
+// network stack directly. Kept so `main.h` can include <SPI.h> unchanged.
+
+#endif  // NATIVE_SPI_H
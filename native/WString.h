@@ -0,0 +1,41 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stdlib.h>
+
+#include <string>
+
+// Minimal Arduino String: enough of the API for ArtNet's config and sender
+// destinations, backed by std::string.
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+    explicit String(char c) : std::string(1, c) {}
+    explicit String(int v, unsigned char base = 10) : std::string(fromLong(v, base)) {}
+    explicit String(unsigned int v, unsigned char base = 10) : std::string(fromLong(v, base)) {}
+    explicit String(long v, unsigned char base = 10) : std::string(fromLong(v, base)) {}
+    explicit String(unsigned long v, unsigned char base = 10) : std::string(fromLong(v, base)) {}
+
+    unsigned int length() const {
+        return (unsigned int)std::string::length();
+    }
+    long toInt() const {
+        return strtol(c_str(), nullptr, 10);
+    }
+
+private:
+    static std::string fromLong(long v, unsigned char base) {
+        char buf[34];
+        if (base == 16) {
+            snprintf(buf, sizeof(buf), "%lx", v);
+        }
+        else {
+            snprintf(buf, sizeof(buf), "%ld", v);
+        }
+        return buf;
+    }
+};
+
+#endif  // NATIVE_WSTRING_H
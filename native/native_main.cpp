@@ -0,0 +1,4 @@
+// Entry point for the `native` environment: runs the sketch's setup()/loop()
+// as an ordinary Linux process.
+
+#include "platforms/stub_main.hpp"
@@ -7,31 +7,587 @@
 #include "main.h"
 
 // Global variable definitions
-const uint8_t NUM_UNIVERSES = (NUM_LEDS + LEDS_PER_UNIVERSE - 1) / LEDS_PER_UNIVERSE;
+#ifdef DMX_PATCH
+constexpr DmxPatch dmxPatch[] = {DMX_PATCH};
+const uint8_t PATCH_ENTRIES   = sizeof(dmxPatch) / sizeof(dmxPatch[0]);
+
+// Universes up to the highest one patched, and the mask of which of them are patched
+constexpr uint8_t patch_universes(uint8_t i) {
+    return i == PATCH_ENTRIES ? 0
+                              : (dmxPatch[i].universe - START_UNIVERSE + 1 > patch_universes(i + 1) ? dmxPatch[i].universe - START_UNIVERSE + 1
+                                                                                                    : patch_universes(i + 1));
+}
+constexpr uint8_t patch_mask(uint8_t i) {
+    return i == PATCH_ENTRIES ? 0 : (1 << (dmxPatch[i].universe - START_UNIVERSE)) | patch_mask(i + 1);
+}
+constexpr bool patch_in_range(uint8_t i) {
+    return i == PATCH_ENTRIES || ((unsigned)(dmxPatch[i].universe - START_UNIVERSE) < 8 && patch_in_range(i + 1));
+}
+static_assert(patch_in_range(0), "DMX_PATCH universes must be START_UNIVERSE to START_UNIVERSE + 7");
+
+const uint8_t NUM_UNIVERSES = patch_universes(0);
+const uint8_t ALL_UNI_MASK  = patch_mask(0);
+#else
+const uint8_t NUM_UNIVERSES = NUM_STRIPS * UNIVERSES_PER_STRIP;
 const uint8_t ALL_UNI_MASK  = (1 << NUM_UNIVERSES) - 1;
+const uint8_t PATCH_ENTRIES = NUM_UNIVERSES;
+#endif
 
 byte mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
 IPAddress ip(192, 168, 1, 50);
 ArtnetEtherReceiver artnet;
+ArtDmxUniverseTable<START_UNIVERSE, NUM_UNIVERSES> artnetUniverses;  // our universes, dispatched without std::function
+volatile bool packetPending   = false;
+unsigned long lastReceivePoll = 0;
+bool networkUp                = false;
+unsigned long lastDhcpPoll    = 0;
+uint8_t helloStep             = 0;
+unsigned long helloTime       = 0;
 
-CRGB leds[NUM_LEDS];
+CRGB leds[LED_BUFFER_PIXELS];
+CopyRun patchRuns[PATCH_ENTRIES];
+uint8_t universeRuns[NUM_UNIVERSES + 1];
+#if PATCH_BUFFER
+uint8_t patchBuffer[512];
+#endif
+#if INGEST_LUT && PIXEL_FORMAT == PIXEL_RGB16
+uint8_t ingestScale[3];
+#elif INGEST_LUT
+uint8_t ingestLut[INGEST_CHANNELS][256];
+#endif
+#if PIXEL_FORMAT == PIXEL_RGB16
+uint8_t ditherError[NUM_LEDS][3];
+#endif
+#if SKIP_UNCHANGED
+uint16_t universeHash[NUM_UNIVERSES];
+uint8_t universesChanged      = 0;
+unsigned long unchangedFrames = 0;
+#endif
+#if UNIVERSE_OUTPUT
+CLEDController* universeStrips[NUM_STRIPS];
+constexpr uint8_t universePins[] = {UNIVERSE_DATA_PINS};
+static_assert(sizeof(universePins) == NUM_STRIPS, "UNIVERSE_DATA_PINS needs one pin per strip");
+#if SKIP_UNCHANGED
+unsigned long universeShowTime[NUM_STRIPS];
+#endif
+#endif
 uint8_t universesReceived             = 0;
 unsigned long lastShowTime            = 0;
 const unsigned long MIN_SHOW_INTERVAL = 8;  // ~125fps max
 
-void led_status(String led, bool state) {
+#if MAX_POWER_MW
+uint32_t universePower[NUM_UNIVERSES];
+uint32_t ledPower = 0;
+#endif
+
+unsigned long frameStartTime  = 0;
+unsigned long partialFrames   = 0;
+unsigned long missedUniverses = 0;
+
+bool frameHeld = false;
+#if FRAME_SCHEDULER
+unsigned long sourcePeriod = 0;
+unsigned long sourceJitter = 0;
+unsigned long periodSum   = 0;
+unsigned long jitterSum   = 0;
+uint8_t scheduleLock      = 0;
+uint8_t scheduleMisses    = 0;
+unsigned long lastArrival = 0;
+unsigned long nextRelease = 0;
+unsigned long lateFrames  = 0;
+#endif
+
+unsigned long framesShown     = 0;
+unsigned long showMicros      = 0;
+unsigned long missedMicros    = 0;
+unsigned long loopMicros      = 0;
+unsigned long maxLoopMicros   = 0;
+unsigned long telemetryTime   = 0;
+unsigned long telemetryFrames = 0;
+uint16_t telemetryReports     = 0;
+uint16_t telemetryFps         = 0;
+
+uint8_t frameSequence[NUM_UNIVERSES];
+uint8_t lastSequence[NUM_UNIVERSES];
+uint8_t staleRun[NUM_UNIVERSES];
+unsigned long stalePackets = 0;
+unsigned long lostPackets  = 0;
+
+bool syncMode              = false;
+unsigned long lastSyncTime = 0;
+IPAddress dmxSource;
+
+void led_status(uint8_t pin, bool state) {
 #if DEBUG
-    Serial.print(led);
+    Serial.print(pin == NETWORK_STATUS_PIN ? F("network") : F("led_write"));
     Serial.print(" LED is now ");
     Serial.println(state ? "ON" : "OFF");
 #endif
 
-    if (led == "network") {
-        digitalWrite(NETWORK_STATUS_PIN, state ? HIGH : LOW);
+    digitalWrite(pin, state ? HIGH : LOW);
+}
+
+void show_frame() {
+#if SKIP_UNCHANGED
+    // Nothing new since the last show: the strip has it already. Refresh it
+    // every KEEPALIVE_INTERVAL anyway, in case it picked up a glitch.
+    if (!universesChanged && millis() - lastShowTime < KEEPALIVE_INTERVAL) {
+        unchangedFrames++;
+        end_frame();
+        return;
+    }
+    universesChanged = 0;
+#endif
+
+    led_status(LED_WRITE_STATUS_PIN, true);
+#if MAX_POWER_MW
+    FastLED.setBrightness(power_brightness());
+#endif
+    unsigned long startMs = millis(), startUs = micros();
+    TRACE_BEGIN(TRACE_SHOW, universesReceived);
+    FastLED.show();
+    count_show(startMs, startUs);
+    TRACE_FINISH(TRACE_SHOW, universesReceived);
+    lastShowTime = millis();
+    end_frame();
+    led_status(LED_WRITE_STATUS_PIN, false);
+}
+
+#if UNIVERSE_OUTPUT
+// Put a universe out on its own strip the moment it has been
+// written, and expect the sender's next packet for it as its next frame.
+void show_universe(uint8_t rel, uint8_t sequence) {
+    if (sequence)
+        frameSequence[rel] = sequence_add(sequence, 1);
+
+#if SKIP_UNCHANGED
+    unsigned long now = millis();
+    if (!(universesChanged & (1 << rel)) && now - universeShowTime[rel] < KEEPALIVE_INTERVAL) {
+        unchangedFrames++;
+        return;
+    }
+    universesChanged &= ~(1 << rel);
+    universeShowTime[rel] = now;
+#endif
+
+    led_status(LED_WRITE_STATUS_PIN, true);
+    unsigned long startMs = millis(), startUs = micros();
+    TRACE_BEGIN(TRACE_SHOW, 1 << rel);
+#if MAX_POWER_MW
+    universeStrips[rel]->showLeds(power_brightness());
+#else
+    universeStrips[rel]->showLeds(FastLED.getBrightness());
+#endif
+    count_show(startMs, startUs);
+    TRACE_FINISH(TRACE_SHOW, 1 << rel);
+    led_status(LED_WRITE_STATUS_PIN, false);
+}
+#endif
+
+// Close the frame being assembled: clear the universe mask and move every
+// sequenced universe on to the number it should carry in the next frame.
+void end_frame() {
+    universesReceived = 0;
+    advance_sequences(1);
+}
+
+void advance_sequences(uint8_t frames) {
+    for (uint8_t rel = 0; rel < NUM_UNIVERSES; rel++) {
+        if (frameSequence[rel])
+            frameSequence[rel] = sequence_add(frameSequence[rel], frames);
+    }
+}
+
+// Art-Net sequence numbers run 1..255 and wrap to 1; 0 means unsequenced
+uint8_t sequence_add(uint8_t sequence, uint8_t n) {
+    uint16_t next = sequence + n;
+    return next > 255 ? next - 255 : next;
+}
+
+// How many steps `to` is ahead of `from` on the 1..255 ring
+uint8_t sequence_distance(uint8_t from, uint8_t to) {
+    int16_t d = (int16_t)to - from;
+    return d < 0 ? d + 255 : d;
+}
+
+// Get leds[] ready for a universe about to be written, or return false to
+// drop a stale packet. The sequence number says which frame a packet belongs
+// to: one the sender has already moved past (more than half the ring behind,
+// or a repeat) is dropped, and one for a later frame puts out what we have
+// before it gets overwritten, unless that would break the rate limit, in which
+// case the held frame is dropped. Unsequenced, a universe we already hold is
+// taken as the start of the next frame.
+bool begin_universe(uint8_t rel, uint8_t sequence) {
+    unsigned long now = millis();
+    bool nextFrame    = universesReceived & (1 << rel);
+    uint8_t ahead     = 0;
+
+    if (sequence && frameSequence[rel]) {
+        ahead = sequence_distance(frameSequence[rel], sequence);
+        if (ahead >= 128 || (ahead == 0 && nextFrame)) {
+            if (++staleRun[rel] < SEQUENCE_RESYNC) {
+                stalePackets++;
+                return false;
+            }
+            // Numbering went back too often in a row: the sender has restarted
+            frameSequence[rel] = sequence;
+            ahead              = 0;
+        }
+        else {
+            uint8_t gap = sequence_distance(lastSequence[rel], sequence);
+            if (gap > 1)
+                lostPackets += gap - 1;
+            nextFrame = ahead > 0;
+        }
+    }
+    else {
+        frameSequence[rel] = sequence;
+    }
+    staleRun[rel]     = 0;
+    lastSequence[rel] = sequence;
+
+#if UNIVERSE_OUTPUT
+    // Every universe is a frame of its own, put out by show_universe()
+    if (!syncMode)
+        return true;
+#endif
+
+    if (nextFrame && universesReceived) {
+        if (!syncMode && now - lastShowTime >= MIN_SHOW_INTERVAL) {
+            if (universesReceived != ALL_UNI_MASK) {
+                count_partial_frame();
+            }
+#if FRAME_SCHEDULER
+            else {
+                schedule_frame();  // still counts for the sender's period, but the next frame is here
+            }
+#endif
+            show_frame();
+        }
+        else {
+            // In sync mode the pixels stay staged for the next ArtSync
+            end_frame();
+        }
+        if (ahead > 1)
+            advance_sequences(ahead - 1);
+    }
+    else if (ahead) {
+        // Nothing held yet: just catch up with the sender
+        advance_sequences(ahead);
+    }
+
+    if (!universesReceived) {
+        frameStartTime = now;
+    }
+    return true;
+}
+
+#if INGEST_LUT
+// Fold gamma, colour temperature, colour correction and brightness into one
+// table per channel, so FastLED can show leds[] without scaling anything.
+// Slow (a pow() per value), so call it only when the settings change: pixels
+// already in leds[] keep the old ones until their universe comes in again.
+void build_ingest_lut(uint8_t brightness) {
+    CRGB adjust = CRGB::computeAdjustment(brightness, CRGB(LED_CORRECTION), CRGB(LED_TEMPERATURE));
+
+#if PIXEL_FORMAT == PIXEL_RGB16
+    // 16-bit levels come from the sender gamma corrected, and only get scaled
+    for (uint8_t c = 0; c < 3; c++) {
+        ingestScale[c] = adjust.raw[c];
+    }
+#else
+    for (uint16_t v = 0; v < 256; v++) {
+        float level = pow(v / 255.0, LED_GAMMA);
+        for (uint8_t c = 0; c < INGEST_CHANNELS; c++) {
+            // White has no colour to correct
+            uint8_t scale   = c < 3 ? adjust.raw[c] : brightness;
+            ingestLut[c][v] = level * scale + 0.5f;
+        }
+    }
+#endif
+}
+#endif
+
+#if PIXEL_OUT_BYTES == 4
+// An RGBW pixel in wire order
+inline void put_rgbw(uint8_t* dst, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+    dst[0] = g;
+    dst[1] = r;
+    dst[2] = b;
+    dst[3] = w;
+}
+#endif
+
+// Copy pixels into the LED buffer from led on, converting them from
+// PIXEL_FORMAT and through the ingest table, or convert them where they are
+// when they were read straight into it. Pixels are stride bytes apart in src
+// and step apart in the buffer. With MAX_POWER_MW, also returns what the
+// pixels draw at full brightness, summed on the way through (a universe's
+// channel sums fit in 16 bits).
+uint32_t ingest_pixels(uint16_t led, const uint8_t* src, uint16_t count, uint8_t stride, int8_t step) {
+#if MAX_POWER_MW
+    uint16_t red = 0, green = 0, blue = 0;
+    uint16_t n = count;
+#endif
+
+#if PIXEL_FORMAT == PIXEL_RGBW
+    uint8_t* dst = (uint8_t*)leds + led * 4;
+    for (; count; count--, src += stride, dst += 4 * step) {
+#if INGEST_LUT
+        put_rgbw(dst, ingestLut[0][src[0]], ingestLut[1][src[1]], ingestLut[2][src[2]], ingestLut[3][src[3]]);
+#else
+        put_rgbw(dst, src[0], src[1], src[2], src[3]);
+#endif
+    }
+#elif PIXEL_FORMAT == PIXEL_RGB_RGBW
+    uint8_t* dst = (uint8_t*)leds + led * 4;
+    for (; count; count--, src += stride, dst += 4 * step) {
+#if INGEST_LUT
+        uint8_t r = ingestLut[0][src[0]], g = ingestLut[1][src[1]], b = ingestLut[2][src[2]], w;
+#else
+        uint8_t r = src[0], g = src[1], b = src[2], w;
+#endif
+        fl::rgb_2_rgbw<RGBW_CONVERSION>(fl::kRGBWDefaultColorTemp, r, g, b, 255, 255, 255, &r, &g, &b, &w);
+        put_rgbw(dst, r, g, b, w);
+    }
+#elif PIXEL_FORMAT == PIXEL_RGB16
+    // What each colour loses to 8 bits is added to it in the next packet, so
+    // the strip averages out to the 16-bit level over a few frames
+    CRGB* dst      = &leds[led];
+    uint8_t* error = ditherError[led];
+    for (; count; count--, src += stride, dst += step, error += 3 * step) {
+        for (uint8_t c = 0; c < 3; c++) {
+            uint16_t level = src[2 * c] << 8 | src[2 * c + 1];
+#if INGEST_LUT
+            level = scale16by8(level, ingestScale[c]);
+#endif
+            uint16_t rest = (level & 0xFF) + error[c];
+            uint8_t out   = level >> 8;
+            if (rest > 0xFF && out < 255)
+                out++;
+            error[c]    = rest;
+            dst->raw[c] = out;
+        }
+#if MAX_POWER_MW
+        red += dst->r;
+        green += dst->g;
+        blue += dst->b;
+#endif
+    }
+#elif INGEST_LUT
+    CRGB* dst = &leds[led];
+    for (; count; count--, src += stride, dst += step) {
+        dst->r = ingestLut[0][src[0]];
+        dst->g = ingestLut[1][src[1]];
+        dst->b = ingestLut[2][src[2]];
+#if MAX_POWER_MW
+        red += dst->r;
+        green += dst->g;
+        blue += dst->b;
+#endif
+    }
+#else
+    CRGB* dst = &leds[led];
+    if (stride == 3 && step == 1) {
+        if (src != (const uint8_t*)dst)
+            memcpy(dst, src, count * 3);
+    }
+    else {
+        const uint8_t* p = src;
+        for (uint16_t i = 0; i < count; i++, p += stride, dst += step) {
+            dst->r = p[0];
+            dst->g = p[1];
+            dst->b = p[2];
+        }
+    }
+#if MAX_POWER_MW
+    for (; count; count--, src += stride) {
+        red += src[0];
+        green += src[1];
+        blue += src[2];
+    }
+#endif
+#endif
+
+#if MAX_POWER_MW
+    return calculate_unscaled_power_mW(red, green, blue, n);
+#else
+    return 0;
+#endif
+}
+
+#if MAX_POWER_MW
+// Swap a universe's old contribution to the power total for its new one
+void account_power(uint8_t rel, uint32_t power) {
+    ledPower += power - universePower[rel];
+    universePower[rel] = power;
+}
+
+// Brightness that keeps everything in leds[] within MAX_POWER_MW, from the
+// running total rather than a pass over leds[] like FastLED's own limiter
+uint8_t power_brightness() {
+    if (ledPower <= MAX_POWER_MW)
+        return 255;
+    return (uint32_t)255 * MAX_POWER_MW / ledPower;
+}
+#endif
+
+// Fletcher-style checksum, without the modulo: any single byte change, and
+// most others, change it
+uint16_t payload_hash(const uint8_t* data, uint16_t size) {
+    uint16_t a = size, b = 0;
+    while (size--) {
+        a += *data++;
+        b += a;
+    }
+    return a ^ (b << 8 | b >> 8);
+}
+
+// Whether a universe's payload differs from the last one accepted for it.
+// Changes are noted in universesChanged for show_frame(). Always true
+// without SKIP_UNCHANGED, and with PIXEL_RGB16, where the dither moves the
+// strip on with every packet even if its levels stay the same.
+bool universe_changed(uint8_t rel, const uint8_t* data, uint16_t size) {
+#if SKIP_UNCHANGED && PIXEL_FORMAT != PIXEL_RGB16
+    uint16_t hash = payload_hash(data, size);
+    if (hash == universeHash[rel])
+        return false;
+    universeHash[rel] = hash;
+#endif
+#if SKIP_UNCHANGED
+    universesChanged |= 1 << rel;
+#endif
+    return true;
+}
+
+// Put a universe's pixels into leds[] by its copy runs and, with
+// MAX_POWER_MW, update its share of the power total. A short packet leaves
+// the pixels it doesn't reach as they were.
+void store_universe(uint8_t rel, const uint8_t* data, uint16_t size) {
+#if MAX_POWER_MW
+    uint32_t power = 0;
+#endif
+
+    for (uint8_t r = universeRuns[rel]; r < universeRuns[rel + 1]; r++) {
+        const CopyRun& run = patchRuns[r];
+        uint16_t count     = 0;
+        if (size >= run.src + PIXEL_IN_BYTES) {
+            count = (size - run.src - PIXEL_IN_BYTES) / run.stride + 1;
+            if (count > run.count)
+                count = run.count;
+        }
+
+#if MAX_POWER_MW
+        power += ingest_pixels(run.dst, data + run.src, count, run.stride, run.step);
+        if (count < run.count) {
+            uint16_t first = run.step > 0 ? run.dst + count : run.dst + 1 - run.count;
+            power += calculate_unscaled_power_mW(&leds[first], run.count - count);
+        }
+#else
+        ingest_pixels(run.dst, data + run.src, count, run.stride, run.step);
+#endif
     }
-    else if (led == "led_write") {
-        digitalWrite(LED_WRITE_STATUS_PIN, state ? HIGH : LOW);
+
+#if MAX_POWER_MW
+    account_power(rel, power);
+#endif
+}
+
+// First LED of a universe, and how many it drives, without a DMX_PATCH.
+// Every strip starts on a universe boundary, so the last universe of a strip
+// may be short.
+uint16_t universe_leds(uint8_t rel, uint16_t& count) {
+    uint8_t strip   = rel / UNIVERSES_PER_STRIP;
+    uint16_t offset = (rel % UNIVERSES_PER_STRIP) * LEDS_PER_UNIVERSE;
+
+    count = LEDS_PER_STRIP - offset;
+    if (count > LEDS_PER_UNIVERSE)
+        count = LEDS_PER_UNIVERSE;
+    return strip * LEDS_PER_STRIP + offset;
+}
+
+// Compile the patch into copy runs, universe by universe, once at startup.
+// Entries are clipped to a universe's 512 channels and to leds[], and one
+// that carries on where the entry before it left off joins its run, so a
+// packet costs an ingest_pixels() per run however the patch is laid out.
+void compile_patch() {
+    uint8_t n = 0;
+
+    for (uint8_t rel = 0; rel < NUM_UNIVERSES; rel++) {
+        universeRuns[rel] = n;
+        for (uint8_t i = 0; i < PATCH_ENTRIES; i++) {
+#ifdef DMX_PATCH
+            DmxPatch entry = dmxPatch[i];
+#else
+            DmxPatch entry = {(uint16_t)(START_UNIVERSE + i), 1, 0, 0, false, 0};
+            entry.led      = universe_leds(i, entry.pixels);
+#endif
+            if (entry.universe != START_UNIVERSE + rel || !entry.channel || entry.led >= NUM_LEDS)
+                continue;
+
+            CopyRun run = {(uint16_t)(entry.channel - 1), entry.led, entry.pixels, (uint8_t)(PIXEL_IN_BYTES + entry.skip),
+                           (int8_t)(entry.reversed ? -1 : 1)};
+            uint16_t fit = run.src + PIXEL_IN_BYTES <= 512 ? (512 - PIXEL_IN_BYTES - run.src) / run.stride + 1 : 0;
+            if (run.count > fit)
+                run.count = fit;
+            fit = run.step > 0 ? NUM_LEDS - run.dst : run.dst + 1;
+            if (run.count > fit)
+                run.count = fit;
+            if (!run.count)
+                continue;
+
+            if (n > universeRuns[rel]) {
+                CopyRun& last = patchRuns[n - 1];
+                if (last.stride == run.stride && last.step == run.step && last.src + last.count * last.stride == run.src &&
+                    last.dst + last.count * last.step == run.dst) {
+                    last.count += run.count;
+                    continue;
+                }
+            }
+            patchRuns[n++] = run;
+        }
+    }
+    universeRuns[NUM_UNIVERSES] = n;
+}
+
+// A universe's run if it is the only one and takes the payload as it comes,
+// pixel for pixel, so the payload can be read straight into leds[] and
+// converted there; nullptr otherwise
+const CopyRun* direct_run(uint8_t rel) {
+    const CopyRun* run = &patchRuns[universeRuns[rel]];
+    if (PIXEL_IN_BYTES != PIXEL_OUT_BYTES || universeRuns[rel + 1] - universeRuns[rel] != 1 || run->src ||
+        run->stride != PIXEL_IN_BYTES || run->step != 1)
+        return nullptr;
+    return run;
+}
+
+// Called once an ArtDmx header has been parsed, before the payload is read off
+// the W5100. The payload is then read straight into this universe's slice of
+// leds[] (or, for one patched any other way, into patchBuffer) and
+// artnet_callback() gets called on it there. Universes that are not ours, and
+// stale packets, are skipped without their payload ever crossing the SPI bus.
+uint8_t* artnet_target(const ArtDmxMetadata& metadata,
+                       uint16_t size,
+                       uint16_t& capacity,
+                       const ArtNetRemoteInfo& remote) {
+    uint8_t rel = metadata.universe - START_UNIVERSE;
+    if (rel >= NUM_UNIVERSES)
+        return nullptr;
+
+    if (!begin_universe(rel, metadata.sequence))
+        return nullptr;
+
+    const CopyRun* run = direct_run(rel);
+    if (run) {
+        capacity = run->count * PIXEL_OUT_BYTES;
+        return (uint8_t*)leds + run->dst * PIXEL_OUT_BYTES;
     }
+#if PATCH_BUFFER
+    capacity = sizeof(patchBuffer);
+    return patchBuffer;
+#else
+    return nullptr;
+#endif
 }
 
 void artnet_callback(const uint8_t* data,
@@ -39,20 +595,36 @@ void artnet_callback(const uint8_t* data,
                      const ArtDmxMetadata& metadata,
                      const ArtNetRemoteInfo& remote) {
     uint8_t rel = metadata.universe - START_UNIVERSE;
+    TRACE_SCOPE(TRACE_CALLBACK, rel);
     if (rel >= NUM_UNIVERSES)
         return;
 
-    uint16_t start = rel * LEDS_PER_UNIVERSE;
-    uint16_t count = (size / 3);
-    if (count > LEDS_PER_UNIVERSE)
-        count = LEDS_PER_UNIVERSE;
-    if (start + count > NUM_LEDS)
-        count = NUM_LEDS - start;
-
-    memcpy(&leds[start], data, count * 3);
+    // Already in place if artnet_target() had it read straight into leds[],
+    // and already begun if it had it read in at all
+    const CopyRun* run = direct_run(rel);
+    bool inPlace       = run && data == (const uint8_t*)leds + run->dst * PIXEL_OUT_BYTES;
+#if PATCH_BUFFER
+    bool targeted = inPlace || data == patchBuffer;
+#else
+    bool targeted = inPlace;
+#endif
+    if (!targeted) {
+        if (!begin_universe(rel, metadata.sequence))
+            return;
+    }
+    // An unchanged universe is already in leds[], unless it has just been
+    // read in raw over its ingested pixels
+    if (universe_changed(rel, data, size) || (inPlace && (INGEST_LUT || PIXEL_FORMAT != PIXEL_RGB)))
+        store_universe(rel, data, size);
 
-    universesReceived |= (1 << rel);
-    unsigned long now = millis();
+    dmxSource = remote.ip;
+#if UNIVERSE_OUTPUT
+    if (!syncMode) {
+        show_universe(rel, metadata.sequence);
+        return;
+    }
+#endif
+    universesReceived |= 1 << rel;
 
 #if DEBUG
     Serial.print("Universe: ");
@@ -61,59 +633,303 @@ void artnet_callback(const uint8_t* data,
     Serial.println(universesReceived, HEX);
 #endif
 
-    if (universesReceived == ALL_UNI_MASK && now - lastShowTime >= MIN_SHOW_INTERVAL) {
-        led_status("led_write", true);
-        FastLED.show();
-        lastShowTime      = now;
-        universesReceived = 0;
-        led_status("led_write", false);
+    // In sync mode the universes are only staged; the next ArtSync latches them.
+    // Art-Net says to fall back to free-running output once the syncs stop.
+    // Otherwise service_frame() puts the frame out from loop(), after the whole
+    // batch of packets has been read and its buffer space handed back to the W5100.
+    if (syncMode && millis() - lastSyncTime > ARTSYNC_TIMEOUT) {
+        syncMode = false;
+    }
+}
+
+void count_partial_frame() {
+    uint8_t missing = 0;
+    for (uint8_t rel = 0; rel < NUM_UNIVERSES; rel++) {
+        if (ALL_UNI_MASK & ~universesReceived & (1 << rel))
+            missing++;
+    }
+    partialFrames++;
+    missedUniverses += missing;
+}
+
+// micros(), plus the time it has missed during shows. Steady across shows,
+// for timing that spans them.
+unsigned long clock_micros() {
+    return micros() + missedMicros;
+}
+
+// Count a show that started at startMs/startUs. Shows that keep interrupts
+// off stop micros() on AVR, but FastLED moves millis() on for them, so
+// whichever says longer is taken.
+void count_show(unsigned long startMs, unsigned long startUs) {
+    unsigned long us = micros() - startUs;
+    unsigned long ms = millis() - startMs;
+    showMicros       = ms * 1000 > us ? ms * 1000 : us;
+    missedMicros += showMicros - us;
+    framesShown++;
+    TRACE_MISSED(showMicros - us);
+}
+
+#if TELEMETRY
+// Time loop() passes, and report every TELEMETRY_INTERVAL. Called at the
+// top of every loop().
+void service_telemetry() {
+    unsigned long now = micros();
+    if (now - loopMicros > maxLoopMicros)
+        maxLoopMicros = now - loopMicros;
+    loopMicros = now;
+
+    if (millis() - telemetryTime >= TELEMETRY_INTERVAL) {
+        report_telemetry();
+        loopMicros = micros();  // the report isn't held against the next pass
+    }
+}
+
+void report_telemetry() {
+    unsigned long now = millis();
+    char text[64];  // the NodeReport, then the DiagData a piece at a time
+
+    telemetryFps    = (framesShown - telemetryFrames) * 1000 / (now - telemetryTime);
+    telemetryFrames = framesShown;
+    telemetryTime   = now;
+    telemetryReports++;
+
+    // "#xxxx [yyyy] text": xxxx is RcPowerOk, yyyy counts reports. Cut to
+    // the reply's 63 characters if the counters ever run that long.
+    snprintf_P(text, sizeof(text), PSTR("#0001 [%04u] %ufps show %luus loop %luus gap %lu"), telemetryReports % 10000,
+               telemetryFps, showMicros, maxLoopMicros, lostPackets);
+    artnet.setArtPollReplyNodeReport(text);
+
+    // DiagData only goes out if the last ArtPoll asked for it. Its header
+    // holds the text's length, so the pieces are formatted twice: once to
+    // add it up, once to send.
+    if (networkUp && artnet.isArtDiagDataRequested()) {
+        uint16_t length = 0;
+        for (uint8_t piece = 0; piece < DIAG_PIECES; piece++)
+            length += format_diag_piece(piece, text, sizeof(text));
+        artnet.beginArtDiagData(length);
+        for (uint8_t piece = 0; piece < DIAG_PIECES; piece++) {
+            format_diag_piece(piece, text, sizeof(text));
+            artnet.writeArtDiagData(text);
+        }
+        artnet.endArtDiagData();
+    }
+    maxLoopMicros = 0;
+}
+
+// One piece of the DiagData text into text, returns its length. Three
+// counters at most, so that a piece fits in the NodeReport's buffer.
+uint8_t format_diag_piece(uint8_t piece, char* text, uint8_t size) {
+    const ArtNetReceiveCounters& rx = artnet.getReceiveCounters();
+    int length                      = 0;
+    switch (piece) {
+        case 0:
+            length = snprintf_P(text, size, PSTR("dmx=%lu nzs=%lu poll=%lu "), (unsigned long)rx.dmx,
+                                (unsigned long)rx.nzs, (unsigned long)rx.poll);
+            break;
+        case 1:
+            length = snprintf_P(text, size, PSTR("sync=%lu trig=%lu other=%lu "), (unsigned long)rx.sync,
+                                (unsigned long)rx.trigger, (unsigned long)rx.other);
+            break;
+        case 2:
+            length = snprintf_P(text, size, PSTR("bad=%lu filt=%lu gap=%lu "), (unsigned long)rx.failed,
+                                (unsigned long)rx.filtered, lostPackets);
+            break;
+        case 3:
+            length = snprintf_P(text, size, PSTR("ovr=%lu shown=%lu part=%lu "),
+                                (unsigned long)artnet.getReceiveOverruns(), framesShown, partialFrames);
+            break;
+        default:
+            length = snprintf_P(text, size, PSTR("fps=%u show=%lu loop=%lu"), telemetryFps, showMicros, maxLoopMicros);
+            break;
+    }
+    return length < size ? length : size - 1;
+}
+#endif
+
+#if TRACE
+// Dump the trace to Serial when TRACE_DUMP_REQUEST comes in on it, for
+// tools/trace_decode. Called every loop().
+void service_trace() {
+    if (Serial.available() && Serial.read() == TRACE_DUMP_REQUEST)
+        trace_dump(Serial);
+}
+#endif
+
+#if FRAME_SCHEDULER
+// Network jitter moves the moment a frame is complete around, so showing it
+// then turns a steady source into uneven frame spacing. Instead, complete
+// frames go out in slots one source period apart: the period is averaged
+// from the time between complete frames, and the slots are pulled in or out
+// until frames wait about twice the jitter seen for theirs, at most
+// SCHEDULE_MAX_HOLD. The held frame stays in leds[] and reception stops
+// meanwhile, so the next frame's packets wait in the W5100's RX memory.
+// Until SCHEDULE_LOCK frames in a row have kept to the period, frames are
+// shown as soon as they are complete, as they are without FRAME_SCHEDULER.
+
+// Take the frame that has just been completed into the period estimate,
+// and return whether it should be held until nextRelease.
+bool schedule_frame() {
+    unsigned long at       = clock_micros();
+    unsigned long interval = at - lastArrival;
+    long off               = (long)interval - (long)sourcePeriod;
+    lastArrival            = at;
+
+    if (sourcePeriod && (unsigned long)labs(off) <= sourcePeriod / 2) {
+        // Running averages, kept 64 times over so that they settle on the
+        // exact value. The period is found over about 8 frames, then
+        // followed over 64 so that jitter doesn't move the slots.
+        long weight    = scheduleLock < SCHEDULE_LOCK ? 8 : 64;
+        periodSum     += ((long)interval * 64 - (long)periodSum) / weight;
+        jitterSum     += (labs(off) * 64 - (long)jitterSum) / 8;
+        sourcePeriod   = (periodSum + 32) / 64;
+        sourceJitter   = (jitterSum + 32) / 64;
+        scheduleMisses = 0;
+        if (scheduleLock < SCHEDULE_LOCK)
+            scheduleLock++;
+    }
+    else if (!sourcePeriod || ++scheduleMisses >= SCHEDULE_RESYNC) {
+        // First interval, or the sender has changed rate: measure it afresh.
+        // Lone misses (a frame lost, or late) keep the estimate we have.
+        sourcePeriod   = interval <= SCHEDULE_MAX_PERIOD * 1000UL ? interval : 0;
+        sourceJitter   = 0;
+        periodSum      = sourcePeriod * 64;
+        jitterSum      = 0;
+        scheduleLock   = 0;
+        scheduleMisses = 0;
+    }
+
+    if (scheduleLock < SCHEDULE_LOCK) {
+        nextRelease = at;
+        return false;
+    }
+
+    // The slot after the last one used, skipping those nothing was shown in
+    // (frames lost, or shown partial) so that it's at most a period behind
+    unsigned long slot = nextRelease + sourcePeriod;
+    if ((long)(at - slot) >= (long)sourcePeriod)
+        slot += (at - slot) / sourcePeriod * sourcePeriod;
+
+    // Hold frames about twice the jitter, and a loop() pass
+    long target = 2 * sourceJitter + 1000;
+    if (target > (long)sourcePeriod / 2)
+        target = sourcePeriod / 2;
+    if (target > SCHEDULE_MAX_HOLD * 1000L)
+        target = SCHEDULE_MAX_HOLD * 1000L;
+
+    // Pull the slots an eighth of the way towards that
+    slot += (target - (long)(slot - at)) / 8;
+    if ((long)(slot - at) > SCHEDULE_MAX_HOLD * 1000L)
+        slot = at + SCHEDULE_MAX_HOLD * 1000L;
+    nextRelease = slot;
+
+    if ((long)(slot - at) <= 0) {
+        // Complete after its slot: show it now and keep the cadence
+        lateFrames++;
+        return false;
+    }
+    return true;
+}
+#endif
+
+// Show the frame being assembled once it is complete (in its slot, with
+// FRAME_SCHEDULER), or once FRAME_TIMEOUT has passed since its first
+// universe. Universes that never arrived keep the previous frame's pixels.
+// Called every loop().
+void service_frame() {
+    if (!universesReceived || syncMode) {
+        return;
+    }
+
+    unsigned long now = millis();
+#if FRAME_SCHEDULER
+    if (frameHeld) {
+        if ((long)(clock_micros() - nextRelease) >= 0) {
+            frameHeld = false;
+            show_frame();
+        }
+        return;
+    }
+#endif
+    if (now - lastShowTime < MIN_SHOW_INTERVAL) {
+        return;
+    }
+
+    if (universesReceived == ALL_UNI_MASK) {
+#if FRAME_SCHEDULER
+        if (schedule_frame()) {
+            frameHeld = true;
+            return;
+        }
+#endif
+        show_frame();
+    }
+    else if (now - frameStartTime >= FRAME_TIMEOUT) {
+        count_partial_frame();
+#if DEBUG
+        Serial.print("Frame timeout | Received: 0x");
+        Serial.print(universesReceived, HEX);
+        Serial.print(" | RX overruns: ");
+        Serial.println(artnet.getReceiveOverruns());
+#endif
+        show_frame();
+    }
+}
+
+void artnet_sync_callback(const ArtNetRemoteInfo& remote) {
+    // ArtSync from anyone but the node sending us ArtDmx is ignored (Art-Net 4)
+    if (!(remote.ip == dmxSource)) {
+        return;
     }
+
+    syncMode     = true;
+    lastSyncTime = millis();
+
+#if DEBUG
+    Serial.print("ArtSync | Received: 0x");
+    Serial.println(universesReceived, HEX);
+#endif
+
+    if (universesReceived) {
+        show_frame();
+    }
+}
+
+// W5100 INT went low: a packet is waiting. SPI is left to receive_packets().
+void ethernet_isr() {
+    packetPending = true;
 }
 
+// Read everything waiting on the W5100. The interrupt is acknowledged first so
+// a packet arriving while we drain pulls INT low again. Also run every
+// RX_POLL_INTERVAL, so pending ArtPollReplies go out and a missed edge
+// cannot stall reception.
+void receive_packets() {
+    packetPending   = false;
+    lastReceivePoll = millis();
+    Ethernet.clearRecvInterrupt();
+    artnet.parseAll();
+}
+
+// The hello dance, a step per HELLO_STEP: bit 0 is the write LED, bit 1 the network LED
+const uint8_t HELLO_STEPS[] = {1, 0, 1, 0, 2, 0, 2, 0, 3, 0, 3, 0, 3, 0, 3, 0, 3, 0};
+
 void led_hello() {
-    // do a little dance to say hello
-    digitalWrite(LED_WRITE_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, LOW);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, LOW);
-    delay(200);
-
-    digitalWrite(NETWORK_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(NETWORK_STATUS_PIN, LOW);
-    delay(200);
-    digitalWrite(NETWORK_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(NETWORK_STATUS_PIN, LOW);
-    delay(200);
-
-    digitalWrite(LED_WRITE_STATUS_PIN, HIGH);
-    digitalWrite(NETWORK_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, LOW);
-    digitalWrite(NETWORK_STATUS_PIN, LOW);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, HIGH);
-    digitalWrite(NETWORK_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, LOW);
-    digitalWrite(NETWORK_STATUS_PIN, LOW);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, HIGH);
-    digitalWrite(NETWORK_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, LOW);
-    digitalWrite(NETWORK_STATUS_PIN, LOW);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, HIGH);
-    digitalWrite(NETWORK_STATUS_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_WRITE_STATUS_PIN, LOW);
-    digitalWrite(NETWORK_STATUS_PIN, LOW);
-    delay(200);
+    // do a little dance to say hello, a step at a time from loop() so
+    // nothing waits on it
+    if (helloStep > sizeof(HELLO_STEPS) || (helloStep && millis() - helloTime < HELLO_STEP))
+        return;
+    helloTime = millis();
+
+    if (helloStep == sizeof(HELLO_STEPS)) {
+        // done: the network LED goes back to saying whether we have an address
+        led_status(NETWORK_STATUS_PIN, networkUp);
+    }
+    else {
+        digitalWrite(LED_WRITE_STATUS_PIN, HELLO_STEPS[helloStep] & 1 ? HIGH : LOW);
+        digitalWrite(NETWORK_STATUS_PIN, HELLO_STEPS[helloStep] & 2 ? HIGH : LOW);
+    }
+    helloStep++;
 }
 
 void led_oh_shit(int led_pin) {
@@ -125,42 +941,138 @@ void led_oh_shit(int led_pin) {
     }
 }
 
+#if UNIVERSE_OUTPUT
+// One controller per strip, on the next pin of UNIVERSE_DATA_PINS
+template <uint8_t PIN>
+void add_universe_strips(uint8_t rel) {
+    uint16_t count;
+    uint16_t start      = universe_leds(rel, count);
+    universeStrips[rel] = &FastLED.addLeds<WS2812B, PIN, GRB>(leds, start, count);
+}
+
+template <uint8_t PIN, uint8_t NEXT, uint8_t... PINS>
+void add_universe_strips(uint8_t rel) {
+    add_universe_strips<PIN>(rel);
+    add_universe_strips<NEXT, PINS...>(rel + 1);
+}
+#endif
+
 void init_leds() {
     // initialize FastLED
+#if UNIVERSE_OUTPUT
+    add_universe_strips<UNIVERSE_DATA_PINS>(0);
+#elif NUM_STRIPS > 1 && defined(FASTLED_HAS_BLOCKLESS)
+    // one strip per pin from 22 up, all written out at once
+    FastLED.addLeds<WS2811_PORTA, NUM_STRIPS, GRB>(leds, LEDS_PER_STRIP);
+#elif PIXEL_OUT_BYTES == 4
+    // RGBW pixels are already in wire order: send the buffer as it is
+    FastLED.addLeds<SK6812, WS2812_DATA_PIN, RGB>(leds, LED_BUFFER_PIXELS);
+#else
     FastLED.addLeds<WS2812B, WS2812_DATA_PIN, GRB>(leds, NUM_LEDS);
+#endif
     FastLED.setMaxRefreshRate(0);  // Remove artificial frame rate limit
     FastLED.setDither(false);
+    // Any correction is done by the ingest table as pixels come in
     FastLED.setCorrection(UncorrectedColor);
+#if INGEST_LUT
+    build_ingest_lut(LED_BRIGHTNESS);
+#endif
     FastLED.clear();
     FastLED.show();
 
     // initialize status pins
     pinMode(NETWORK_STATUS_PIN, OUTPUT);
     pinMode(LED_WRITE_STATUS_PIN, OUTPUT);
+}
 
-    led_hello();
+#if DHCP
+// The stored lease, if there is one and it was granted to this mac[]
+bool load_lease(DhcpLease& lease) {
+    EEPROM.get(LEASE_EEPROM_ADDR, lease);
+    return lease.magic == LEASE_MAGIC && memcmp(lease.mac, mac, sizeof(lease.mac)) == 0;
 }
 
-void init_networking() {
-    if (DHCP) {
-        if (Ethernet.begin(mac)) {
-            // DHCP configured successfully :)
-        }
-        else {
-            // shit shit shit shit shit
-            led_oh_shit(NETWORK_STATUS_PIN);
-        }
+void save_lease() {
+    DhcpLease lease;
+    IPAddress address = Ethernet.localIP();
+    IPAddress subnet  = Ethernet.subnetMask();
+    IPAddress gateway = Ethernet.gatewayIP();
+
+    lease.magic = LEASE_MAGIC;
+    memcpy(lease.mac, mac, sizeof(lease.mac));
+    for (uint8_t i = 0; i < 4; i++) {
+        lease.ip[i]      = address[i];
+        lease.subnet[i]  = subnet[i];
+        lease.gateway[i] = gateway[i];
     }
-    else {
-        Ethernet.begin(mac, ip);
+    // put() only writes the bytes that changed, so renewals of the same lease cost no EEPROM wear
+    EEPROM.put(LEASE_EEPROM_ADDR, lease);
+}
+
+void forget_lease() {
+    EEPROM.update(LEASE_EEPROM_ADDR, 0xFF);
+}
+
+// One step of the DHCP exchange
+void service_dhcp() {
+    if (millis() - lastDhcpPoll < DHCP_POLL_INTERVAL)
+        return;
+    lastDhcpPoll = millis();
+
+    switch (Ethernet.maintainDHCP()) {
+        case DHCP_POLL_LEASED:
+            networkUp = true;
+            save_lease();
+            led_status(NETWORK_STATUS_PIN, true);
+#if DEBUG
+            Serial.print("DHCP lease: ");
+            Serial.println(Ethernet.localIP());
+#endif
+            break;
+        case DHCP_POLL_REFUSED:
+            // the stored lease is someone else's now, a new one is on its way
+            networkUp = false;
+            forget_lease();
+            led_status(NETWORK_STATUS_PIN, false);
+            break;
     }
+}
+#endif
 
-    if (Ethernet.linkStatus() == LinkON) {
-        led_status("network", true);
+void init_networking() {
+#ifdef ETHERNET_LARGE_BUFFERS
+    // artnet.begin() below takes socket 0. DHCP only opens its socket, the
+    // next one, from loop(), and needs no more than 1K. The other sockets
+    // share what's left.
+    Ethernet.setSocketBufferSize(0, ARTNET_RX_BUFFER_KB);
+#if DHCP
+    Ethernet.setSocketBufferSize(1, 1, 1);
+#endif
+#endif
+
+#if DHCP
+    // The lease is got from loop(). If there's one stored, it's used from
+    // the start while it's asked for again, so Art-Net comes in at once.
+    DhcpLease lease;
+    int chip;
+    if (load_lease(lease)) {
+        networkUp = true;
+        chip      = Ethernet.beginDHCP(mac, IPAddress(lease.ip), IPAddress(lease.subnet), IPAddress(lease.gateway));
     }
     else {
+        chip = Ethernet.beginDHCP(mac);
+    }
+    if (!chip) {
+        // shit shit shit shit shit
         led_oh_shit(NETWORK_STATUS_PIN);
     }
+#else
+    Ethernet.begin(mac, ip);
+    networkUp = true;
+#endif
+
+    // The link may still be coming up, so it only sets the network LED
+    led_status(NETWORK_STATUS_PIN, networkUp && Ethernet.linkStatus() != LinkOFF);
 
 #if DEBUG
     Serial.print("Ethernet initialized with IP: ");
@@ -173,9 +1085,19 @@ void init_networking() {
     Serial.println(Ethernet.linkStatus() == LinkON ? "LinkON" : "LinkOFF");
 #endif
 
-    delay(100);
     artnet.begin(ARTNET_PORT);
-    artnet.subscribeArtDmx(artnet_callback);
+    for (uint8_t rel = 0; rel < NUM_UNIVERSES; rel++) {
+        if (ALL_UNI_MASK & (1 << rel))
+            artnetUniverses.set(START_UNIVERSE + rel, ZERO_COPY ? artnet_target : nullptr, artnet_callback);
+    }
+    artnet.subscribeArtDmxUniverseTable(artnetUniverses);
+    artnet.subscribeArtSync(artnet_sync_callback);
+
+#if ETHERNET_INT_PIN >= 0
+    pinMode(ETHERNET_INT_PIN, INPUT_PULLUP);
+    Ethernet.enableRecvInterrupt();
+    attachInterrupt(digitalPinToInterrupt(ETHERNET_INT_PIN), ethernet_isr, FALLING);
+#endif
 
 #if DEBUG
     Serial.print("IP: ");
@@ -186,26 +1108,52 @@ void init_networking() {
 }
 
 void setup() {
-#if DEBUG
+#if DEBUG || TRACE
     Serial.begin(115200);
+#endif
+#if DEBUG
     Serial.println("Starting Artnet LED Decoder");
 #endif
 
     init_leds();
+    compile_patch();
     init_networking();
+    loopMicros = micros();
 }
 
 void loop() {
     if (TEST_MODE) {
-        for (int i = 0; i < NUM_LEDS; i++) {
-            leds[i] = CRGB::Red;
-        }
+        // Full red, in whichever format pixels come in
+        const uint8_t red[PIXEL_IN_BYTES] = {255, PIXEL_FORMAT == PIXEL_RGB16 ? 255 : 0};
+        ingest_pixels(0, red, NUM_LEDS, 0, 1);
+#if MAX_POWER_MW
+        FastLED.setMaxPowerInMilliWatts(MAX_POWER_MW);
+#endif
 
         FastLED.show();
         while (1)
-            ;  // halt!
+            led_hello();  // halt!
     }
     else {
-        artnet.parse();
+#if TELEMETRY
+        service_telemetry();
+#endif
+#if TRACE
+        service_trace();
+#endif
+        led_hello();
+#if DHCP
+        service_dhcp();
+#endif
+        // While a frame is held for its slot, packets wait in the W5100
+#if ETHERNET_INT_PIN >= 0
+        if (!frameHeld && (packetPending || millis() - lastReceivePoll >= RX_POLL_INTERVAL)) {
+            receive_packets();
+        }
+#else
+        if (!frameHeld)
+            artnet.parseAll();
+#endif
+        service_frame();
     }
 }
@@ -0,0 +1,552 @@
+// ArtNet load generator and end-to-end latency benchmark
+// by Miles Punch
+
+// All Rights Reserved 2025
+// Licensed under the GNU GPL License.
+
+// Runs the firmware's setup()/loop() in-process (native env) and drives it
+// with ArtDmx traffic over loopback UDP from a sender thread built on
+// art_net::Sender_. Every universe payload carries the frame number in its
+// first pixel, so a FastLED engine listener can tell which packet each slice
+// of a show() came from: latency is measured from the newest of those packets
+// leaving the sender, and a show mixing frames is counted as torn.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "fl/engine_events.h"
+#include "main.h"
+
+// sketch entry points from src/main.cpp
+void setup();
+void loop();
+
+using BenchClock = std::chrono::steady_clock;
+
+enum class PacketOrder : uint8_t {
+    InOrder,
+    Reverse,
+    Shuffle,
+};
+
+struct BenchConfig {
+    uint8_t universes      = NUM_UNIVERSES;
+    float fps              = 40.0f;
+    float seconds          = 10.0f;
+    PacketOrder order      = PacketOrder::InOrder;
+    float loss_pct         = 0.0f;  // chance each packet is never sent
+    float late_pct         = 0.0f;  // chance each packet is held back behind the next one
+    uint32_t jitter_us     = 0;     // uniform random delay added before each packet
+    uint32_t wire_us       = 0;     // emulated output time per LED inside show()
+    bool sync              = false; // send an ArtSync after every frame
+    uint16_t port          = ARTNET_PORT;
+    const char* replay     = nullptr;
+    const char* capture    = nullptr;
+    unsigned long seed     = 1;
+};
+
+// Recording format used by --capture and --replay: a flat sequence of
+//   uint32 LE  microseconds since the first packet
+//   uint16 LE  payload length
+//   payload    raw Art-Net UDP payload
+struct RecordedPacket {
+    uint32_t at_us;
+    std::vector<uint8_t> data;
+};
+
+struct ShowEvent {
+    BenchClock::time_point at;
+    std::vector<uint32_t> frames;  // frame id latched for each universe
+};
+
+static BenchConfig config;
+static std::vector<BenchClock::time_point> packetSentAt;  // indexed by frame * universes + universe
+static std::vector<uint8_t> frameSentCount;                // packets actually sent per frame
+static std::vector<ShowEvent> shows;
+static std::atomic<bool> senderDone(false);
+static uint32_t packetsAbsorbed = 0;
+static uint32_t packetsSent     = 0;
+static uint32_t packetsLost     = 0;
+
+static uint32_t read_frame_id(const CRGB& px) {
+    return ((uint32_t)px.r << 16) | ((uint32_t)px.g << 8) | px.b;
+}
+
+static void write_frame_id(uint8_t* data, uint32_t frame) {
+#if PIXEL_FORMAT == PIXEL_RGB16
+    // high bytes, with low bytes of 0 so that there is nothing to dither
+    const uint8_t size = 2;
+    data[1] = data[3] = data[5] = 0;
+#else
+    const uint8_t size = 1;
+#endif
+    data[0]        = (frame >> 16) & 0xFF;
+    data[size]     = (frame >> 8) & 0xFF;
+    data[2 * size] = frame & 0xFF;
+}
+
+class ShowProbe : public fl::EngineEvents::Listener {
+public:
+    ShowProbe() {
+        fl::EngineEvents::addListener(this);
+    }
+    ~ShowProbe() {
+        fl::EngineEvents::removeListener(this);
+    }
+
+    // The stub backend outputs instantly; burn the wire time a real strip
+    // would take before the show counts as done.
+    void onEndFrame() override {
+        if (!config.wire_us)
+            return;
+        BenchClock::time_point until = BenchClock::now() + std::chrono::microseconds(config.wire_us * LEDS_PER_STRIP);
+        while (BenchClock::now() < until)
+            ;
+    }
+
+    void onEndShowLeds() override {
+        BenchClock::time_point now = BenchClock::now();
+        if (read_frame_id(leds[0]) == 0)
+            return;  // init_leds() clear, before the first frame arrived
+
+        ShowEvent e {now, std::vector<uint32_t>(config.universes)};
+        uint16_t count;
+        for (uint8_t u = 0; u < config.universes && u < NUM_UNIVERSES; u++)
+            e.frames[u] = read_frame_id(leds[universe_leds(u, count)]);
+        shows.push_back(std::move(e));
+    }
+};
+
+static bool load_recording(const char* path, std::vector<RecordedPacket>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    uint8_t hdr[6];
+    while (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr)) {
+        RecordedPacket p;
+        p.at_us     = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | ((uint32_t)hdr[3] << 24);
+        uint16_t sz = hdr[4] | (hdr[5] << 8);
+        p.data.resize(sz);
+        if (fread(p.data.data(), 1, sz, f) != sz)
+            break;
+        out.push_back(std::move(p));
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+static int run_capture() {
+    FILE* f = fopen(config.capture, "wb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", config.capture);
+        return 1;
+    }
+
+    EthernetUDP udp;
+    if (!udp.begin(config.port)) {
+        fprintf(stderr, "cannot bind port %u\n", config.port);
+        return 1;
+    }
+
+    printf("capturing Art-Net on port %u for %.1f s -> %s\n", config.port, config.seconds, config.capture);
+    uint8_t buf[EthernetUDP::RX_BUFFER_SIZE];
+    uint32_t count                 = 0;
+    BenchClock::time_point start   = BenchClock::now();
+    BenchClock::time_point first   = start;
+    BenchClock::time_point end     = start + std::chrono::milliseconds((long)(config.seconds * 1000));
+    while (BenchClock::now() < end) {
+        int size = udp.parsePacket();
+        if (size <= 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        udp.read(buf, size);
+
+        BenchClock::time_point now = BenchClock::now();
+        if (count == 0)
+            first = now;
+        uint32_t at    = std::chrono::duration_cast<std::chrono::microseconds>(now - first).count();
+        uint8_t hdr[6] = {(uint8_t)at, (uint8_t)(at >> 8), (uint8_t)(at >> 16), (uint8_t)(at >> 24), (uint8_t)size,
+                          (uint8_t)(size >> 8)};
+        fwrite(hdr, 1, sizeof(hdr), f);
+        fwrite(buf, 1, size, f);
+        count++;
+    }
+    fclose(f);
+    printf("captured %u packets\n", count);
+    return 0;
+}
+
+// Applies loss, jitter and late delivery to each outgoing ArtDmx packet.
+// Packets are built here so the Art-Net sequence is stamped when a packet is
+// generated: a lost packet leaves a gap and a late one keeps its old number.
+class LoadGenerator {
+public:
+    LoadGenerator() : rng(config.seed), held(false) {
+        sender.begin(0);
+        udp.begin(0);
+    }
+
+    void send(uint16_t universe, uint32_t frame, const uint8_t* data, uint16_t size) {
+        std::vector<uint8_t> packet(art_net::HEADER_SIZE + size);
+        art_net::art_dmx::setMetadataTo(packet.data(), next_sequence(universe), 0, (universe >> 8) & 0x7F,
+                                        (universe >> 4) & 0x0F, universe & 0x0F);
+        packet[art_net::art_dmx::LENGTH_H] = size >> 8;
+        packet[art_net::art_dmx::LENGTH_L] = size & 0xFF;
+        memcpy(packet.data() + art_net::HEADER_SIZE, data, size);
+
+        std::uniform_real_distribution<float> pct(0.0f, 100.0f);
+        if (pct(rng) < config.loss_pct) {
+            packetsLost++;
+            return;
+        }
+        if (config.jitter_us) {
+            std::uniform_int_distribution<uint32_t> jitter(0, config.jitter_us);
+            std::this_thread::sleep_for(std::chrono::microseconds(jitter(rng)));
+        }
+        if (!held && pct(rng) < config.late_pct) {
+            held       = true;
+            heldPacket = {universe, frame, std::move(packet)};
+            return;
+        }
+
+        transmit(universe, frame, packet);
+        if (held && heldPacket.universe == universe) {
+            held = false;
+            transmit(heldPacket.universe, heldPacket.frame, heldPacket.data);
+        }
+    }
+
+    void finish() {
+        if (held) {
+            held = false;
+            transmit(heldPacket.universe, heldPacket.frame, heldPacket.data);
+        }
+    }
+
+    void sync() {
+        sender.sendArtSync(target);
+    }
+
+private:
+    struct HeldPacket {
+        uint16_t universe;
+        uint32_t frame;
+        std::vector<uint8_t> data;
+    };
+
+    uint8_t next_sequence(uint16_t universe) {
+        uint8_t& seq = sequences[universe];
+        seq          = (seq == 0xFF) ? 1 : seq + 1;
+        return seq;
+    }
+
+    void transmit(uint16_t universe, uint32_t frame, const std::vector<uint8_t>& packet) {
+        udp.beginPacket(IPAddress(127, 0, 0, 1), art_net::DEFAULT_PORT);
+        udp.write(packet.data(), packet.size());
+        udp.endPacket();
+        packetsSent++;
+
+        uint8_t rel = universe - START_UNIVERSE;
+        if (frame < frameSentCount.size() && rel < config.universes) {
+            packetSentAt[frame * config.universes + rel] = BenchClock::now();
+            frameSentCount[frame]++;
+        }
+    }
+
+    ArtnetEtherSender sender;
+    EthernetUDP udp;
+    String target {"127.0.0.1"};
+    std::map<uint16_t, uint8_t> sequences;
+    std::mt19937 rng;
+    bool held;
+    HeldPacket heldPacket;
+};
+
+static void sender_synthetic() {
+    LoadGenerator gen;
+    uint32_t frames = (uint32_t)(config.fps * config.seconds);
+    packetSentAt.assign((frames + 1) * config.universes, BenchClock::time_point());
+    frameSentCount.assign(frames + 1, 0);
+
+    std::vector<uint8_t> order(config.universes);
+    std::mt19937 rng(config.seed + 1);
+    uint8_t payload[CHANNELS_PER_UNIVERSE];
+
+    std::chrono::microseconds period((long)(1000000.0f / config.fps));
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t frame = 1; frame <= frames; frame++) {
+        std::this_thread::sleep_until(start + period * (frame - 1));
+
+        for (uint8_t i = 0; i < config.universes; i++)
+            order[i] = i;
+        if (config.order == PacketOrder::Reverse)
+            std::reverse(order.begin(), order.end());
+        else if (config.order == PacketOrder::Shuffle)
+            std::shuffle(order.begin(), order.end(), rng);
+
+        for (uint8_t rel : order) {
+            // a slow ramp in the remaining pixels so the content isn't static
+            memset(payload, (uint8_t)(frame + rel), sizeof(payload));
+            write_frame_id(payload, frame);
+            gen.send(START_UNIVERSE + rel, frame, payload, sizeof(payload));
+        }
+        if (config.sync)
+            gen.sync();
+    }
+    gen.finish();
+    senderDone = true;
+}
+
+static void sender_replay(const std::vector<RecordedPacket>& recording) {
+    LoadGenerator gen;
+    packetSentAt.assign((recording.size() + 1) * config.universes, BenchClock::time_point());
+    frameSentCount.assign(recording.size() + 1, 0);
+
+    // A recorded frame starts at each packet for START_UNIVERSE; stamp that
+    // frame number into every ArtDmx packet until the next one.
+    uint32_t frame               = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (const RecordedPacket& p : recording) {
+        std::this_thread::sleep_until(start + std::chrono::microseconds(p.at_us));
+        if (p.data.size() < art_net::HEADER_SIZE || memcmp(p.data.data(), art_net::ARTNET_ID, art_net::ID_LENGTH))
+            continue;
+
+        uint16_t opcode = p.data[art_net::art_dmx::OP_CODE_L] | (p.data[art_net::art_dmx::OP_CODE_H] << 8);
+        if (opcode == (uint16_t)art_net::OpCode::Sync) {
+            gen.sync();
+            continue;
+        }
+        if (opcode != (uint16_t)art_net::OpCode::Dmx)
+            continue;
+
+        uint16_t universe = (p.data[art_net::art_dmx::NET] << 8) | p.data[art_net::art_dmx::SUBUNI];
+        if (universe == START_UNIVERSE)
+            frame++;
+        if (frame == 0)
+            continue;  // wait for the first complete frame boundary
+
+        std::vector<uint8_t> payload(p.data.begin() + art_net::HEADER_SIZE, p.data.end());
+        if (payload.size() < 3)
+            continue;
+        write_frame_id(payload.data(), frame);
+        gen.send(universe, frame, payload.data(), payload.size());
+    }
+    gen.finish();
+    senderDone = true;
+}
+
+static void usage(const char* argv0) {
+    printf(
+        "usage: %s [options]\n"
+        "  -u, --universes N      universes per frame (default %u)\n"
+        "  -f, --fps F            synthetic frame rate (default 40)\n"
+        "  -s, --seconds S        run length (default 10)\n"
+        "  -o, --order MODE       inorder | reverse | shuffle\n"
+        "  -l, --loss PCT         drop PCT%% of packets\n"
+        "  -L, --late PCT         deliver PCT%% of packets after their universe's next one\n"
+        "  -j, --jitter US        up to US microseconds random delay per packet\n"
+        "  -w, --wire-us US       emulate US microseconds of output per LED in show()\n"
+        "  -y, --sync             follow every synthetic frame with an ArtSync\n"
+        "  -r, --replay FILE      replay a recording instead of synthetic frames\n"
+        "  -c, --capture FILE     record Art-Net arriving on --port to FILE and exit\n"
+        "  -p, --port PORT        capture port (default %u)\n"
+        "      --seed N           RNG seed (default 1)\n",
+        argv0,
+        NUM_UNIVERSES,
+        ARTNET_PORT);
+}
+
+static bool parse_args(int argc, char** argv) {
+    static const option options[] = {
+        {"universes", required_argument, nullptr, 'u'}, {"fps", required_argument, nullptr, 'f'},
+        {"seconds", required_argument, nullptr, 's'},   {"order", required_argument, nullptr, 'o'},
+        {"loss", required_argument, nullptr, 'l'},      {"late", required_argument, nullptr, 'L'},
+        {"jitter", required_argument, nullptr, 'j'},    {"wire-us", required_argument, nullptr, 'w'},
+        {"replay", required_argument, nullptr, 'r'},    {"capture", required_argument, nullptr, 'c'},
+        {"port", required_argument, nullptr, 'p'},      {"seed", required_argument, nullptr, 'S'},
+        {"sync", no_argument, nullptr, 'y'},            {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "u:f:s:o:l:L:j:w:r:c:p:yh", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'u': config.universes = (uint8_t)atoi(optarg); break;
+            case 'f': config.fps = atof(optarg); break;
+            case 's': config.seconds = atof(optarg); break;
+            case 'l': config.loss_pct = atof(optarg); break;
+            case 'L': config.late_pct = atof(optarg); break;
+            case 'j': config.jitter_us = strtoul(optarg, nullptr, 10); break;
+            case 'w': config.wire_us = strtoul(optarg, nullptr, 10); break;
+            case 'r': config.replay = optarg; break;
+            case 'c': config.capture = optarg; break;
+            case 'p': config.port = (uint16_t)atoi(optarg); break;
+            case 'S': config.seed = strtoul(optarg, nullptr, 10); break;
+            case 'y': config.sync = true; break;
+            case 'o':
+                if (!strcmp(optarg, "inorder"))
+                    config.order = PacketOrder::InOrder;
+                else if (!strcmp(optarg, "reverse"))
+                    config.order = PacketOrder::Reverse;
+                else if (!strcmp(optarg, "shuffle"))
+                    config.order = PacketOrder::Shuffle;
+                else
+                    return false;
+                break;
+            default: return false;
+        }
+    }
+    if (config.universes > NUM_UNIVERSES) {
+        // shows only carry the firmware's universes, so every frame would count as torn
+        fprintf(stderr, "--universes %u is more than the firmware's %u\n", config.universes, NUM_UNIVERSES);
+        return false;
+    }
+    return config.universes > 0 && config.fps > 0 && config.seconds > 0;
+}
+
+static double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    size_t idx = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+static void report(double elapsed_s) {
+    std::vector<bool> shown(frameSentCount.size(), false);
+    std::vector<double> latency_us;
+    uint32_t torn        = 0;
+    uint32_t framesShown = 0;
+    for (const ShowEvent& s : shows) {
+        // latency runs from the newest packet whose data made it into this show
+        BenchClock::time_point newest;
+        bool intact = true;
+        bool known  = true;
+        for (uint8_t u = 0; u < s.frames.size(); u++) {
+            uint32_t frame = s.frames[u];
+            if (frame >= frameSentCount.size()) {
+                known = false;
+                break;
+            }
+            newest = std::max(newest, packetSentAt[frame * config.universes + u]);
+            if (frame != s.frames[0])
+                intact = false;
+        }
+        if (!known)
+            continue;
+        latency_us.push_back(std::chrono::duration<double, std::micro>(s.at - newest).count());
+
+        if (!intact)
+            torn++;
+        else if (!shown[s.frames[0]]) {
+            shown[s.frames[0]] = true;
+            framesShown++;
+        }
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+
+    // spacing between consecutive shows: how steady the output cadence is
+    std::vector<double> spacing_us;
+    for (size_t i = 1; i < shows.size(); i++)
+        spacing_us.push_back(std::chrono::duration<double, std::micro>(shows[i].at - shows[i - 1].at).count());
+    double mean = 0, sd = 0;
+    for (double d : spacing_us)
+        mean += d / spacing_us.size();
+    for (double d : spacing_us)
+        sd += (d - mean) * (d - mean) / spacing_us.size();
+    sd = std::sqrt(sd);
+    std::sort(spacing_us.begin(), spacing_us.end());
+
+    uint32_t framesSent = 0;
+    for (size_t i = 1; i < frameSentCount.size(); i++) {
+        if (frameSentCount[i])
+            framesSent++;
+    }
+
+    printf("duration            %.2f s\n", elapsed_s);
+    printf("packets sent        %u (%u dropped by generator)\n", packetsSent, packetsLost);
+    printf("packets absorbed    %u (%.0f/s)\n", packetsAbsorbed, packetsAbsorbed / elapsed_s);
+    printf("frames sent         %u\n", framesSent);
+    printf("show() calls        %zu (%.1f/s)\n", shows.size(), shows.size() / elapsed_s);
+    printf("frames shown        %u (%.1f fps)\n", framesShown, framesShown / elapsed_s);
+    printf("frames dropped      %u\n", framesSent > framesShown ? framesSent - framesShown : 0);
+    printf("torn shows          %u\n", torn);
+    printf("partial frames      %lu (%lu universes missing)\n", partialFrames, missedUniverses);
+    printf("sequence            %lu stale rejected, %lu lost\n", stalePackets, lostPackets);
+    printf("latency us          p50 %.0f  p90 %.0f  p99 %.0f  max %.0f\n",
+           percentile(latency_us, 50),
+           percentile(latency_us, 90),
+           percentile(latency_us, 99),
+           latency_us.empty() ? 0.0 : latency_us.back());
+    printf("show spacing us     mean %.0f  sd %.0f  min %.0f  max %.0f\n",
+           mean,
+           sd,
+           spacing_us.empty() ? 0.0 : spacing_us.front(),
+           spacing_us.empty() ? 0.0 : spacing_us.back());
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (config.capture)
+        return run_capture();
+
+    std::vector<RecordedPacket> recording;
+    if (config.replay && !load_recording(config.replay, recording)) {
+        fprintf(stderr, "cannot load recording %s\n", config.replay);
+        return 1;
+    }
+
+    // skip the boot-time delays
+    setDelayFunction([](uint32_t) {});
+    setup();
+    setDelayFunction(fl::function<void(uint32_t)>());
+
+#if INGEST_LUT && PIXEL_FORMAT == PIXEL_RGB16
+    // Frame ids have to survive ingest: same scaling, at full scale
+    for (uint8_t c = 0; c < 3; c++)
+        ingestScale[c] = 255;
+#elif INGEST_LUT
+    // Frame ids have to survive ingest: same lookups, identity table
+    for (uint8_t c = 0; c < 3; c++)
+        for (uint16_t v = 0; v < 256; v++)
+            ingestLut[c][v] = v;
+#endif
+
+    for (uint8_t u = 0; u < config.universes; u++) {
+        artnet.subscribeArtDmxUniverse((uint16_t)(START_UNIVERSE + u),
+                                       [](const uint8_t*, uint16_t, const ArtDmxMetadata&, const ArtNetRemoteInfo&) {
+                                           packetsAbsorbed++;
+                                       });
+    }
+    ShowProbe probe;
+    shows.reserve((size_t)(config.fps * config.seconds * 2) + 16);
+
+    BenchClock::time_point start = BenchClock::now();
+    std::thread sender = config.replay ? std::thread(sender_replay, std::cref(recording)) : std::thread(sender_synthetic);
+
+    // keep draining for a moment after the last packet so in-flight frames count
+    BenchClock::time_point drainUntil = BenchClock::time_point::max();
+    while (BenchClock::now() < drainUntil) {
+        loop();
+        if (senderDone && drainUntil == BenchClock::time_point::max())
+            drainUntil = BenchClock::now() + std::chrono::milliseconds(200);
+    }
+    sender.join();
+
+    report(std::chrono::duration<double>(BenchClock::now() - start).count());
+    return 0;
+}
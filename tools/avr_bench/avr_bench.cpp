@@ -0,0 +1,601 @@
+// Cycle-accurate AVR benchmark
+// by Miles Punch
+
+// All Rights Reserved 2025
+// Licensed under the GNU GPL License.
+
+// Runs the real Mega 2560 firmware (env:mega_sim) under simavr, with a
+// W5100 on the SPI bus modelled well enough for the Ethernet library: MR
+// reset and chip detection, the socket registers and commands, and the
+// RX/TX buffers as sized by RMSR/TMSR. Once the firmware has opened its
+// Art-Net socket, ArtDmx packets are dropped into that socket's RX buffer
+// on schedule, either synthetic frames or an artnet_bench recording.
+//
+// Every call to the hot-path functions below is timed in CPU cycles, from
+// the function's first instruction until the stack pointer shows it has
+// returned. Interrupts taken in between (the millis() timer) are included,
+// as they are on the hardware. simavr times each SPI byte from the SPI
+// clock divider, so time spent talking to the W5100 is counted too.
+
+#include <cxxabi.h>
+#include <fcntl.h>
+#include <gelf.h>
+#include <getopt.h>
+#include <libelf.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_spi.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const uint32_t F_CPU_HZ  = 16000000;
+static const uint16_t ARTNET_PORT = 6454;
+
+struct BenchConfig {
+    const char* elf        = ".pio/build/mega_sim/firmware.elf";
+    uint8_t universes      = 2;
+    uint16_t start         = 0;  // first universe, START_UNIVERSE in the firmware
+    float fps              = 40.0f;
+    float seconds          = 2.0f;
+    float boot_seconds     = 30.0f;  // give up if the Art-Net socket isn't open by then
+    const char* replay     = nullptr;
+};
+
+// Same format as artnet_bench's --capture/--replay:
+//   uint32 LE  microseconds since the first packet
+//   uint16 LE  payload length
+//   payload    raw Art-Net UDP payload
+struct RecordedPacket {
+    uint32_t at_us;
+    std::vector<uint8_t> data;
+};
+
+// Functions timed, matched against the demangled names in the ELF. Clones
+// made by the optimiser ("[clone .constprop.0]") are timed as the original.
+struct Probe {
+    const char* label;
+    const char* match;
+    const char* owner;  // for template members: the class the match must be in
+    bool found;
+    uint32_t calls;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+// loop() receives through parseAll(), a batch per pass; parseNext() is
+// each packet in it.
+static Probe probes[] = {
+    {"Receiver_::parseAll", "::parseAll(", "Receiver_<", false, 0, 0, UINT64_MAX, 0},
+    {"Receiver_::parseNext", "::parseNext(", "Receiver_<", false, 0, 0, UINT64_MAX, 0},
+    {"artnet_callback", "artnet_callback(", nullptr, false, 0, 0, UINT64_MAX, 0},
+    {"W5100Class::read", "W5100Class::read(", nullptr, false, 0, 0, UINT64_MAX, 0},
+    {"FastLED.show()", "CFastLED::show(", nullptr, false, 0, 0, UINT64_MAX, 0},
+};
+static const uint8_t NUM_PROBES = sizeof(probes) / sizeof(probes[0]);
+
+static bool probe_matches(const Probe& p, const std::string& name) {
+    if (name.find(p.match) == std::string::npos)
+        return false;
+    return !p.owner || name.find(p.owner) != std::string::npos;
+}
+
+static BenchConfig config;
+
+/***************************************************/
+/**                  W5100 model                  **/
+/***************************************************/
+
+// Register map, W5100 datasheet section 3
+enum : uint16_t {
+    MR        = 0x0000,
+    RMSR      = 0x001A,
+    TMSR      = 0x001B,
+    SOCK_BASE = 0x0400,
+    SOCK_SIZE = 0x0100,
+    TX_BASE   = 0x4000,
+    RX_BASE   = 0x6000,
+    MEM_SIZE  = 0x8000,
+};
+
+enum : uint8_t {
+    Sn_MR     = 0x00,
+    Sn_CR     = 0x01,
+    Sn_IR     = 0x02,
+    Sn_SR     = 0x03,
+    Sn_PORT   = 0x04,
+    Sn_TX_FSR = 0x20,
+    Sn_TX_RD  = 0x22,
+    Sn_TX_WR  = 0x24,
+    Sn_RX_RSR = 0x26,
+    Sn_RX_RD  = 0x28,
+};
+
+enum : uint8_t {
+    CMD_OPEN  = 0x01,
+    CMD_CLOSE = 0x10,
+    CMD_SEND  = 0x20,
+    CMD_RECV  = 0x40,
+};
+
+static const uint8_t SOCK_UDP = 0x22;
+static const uint8_t IR_RECV  = 0x04;
+static const uint8_t IR_SEND  = 0x10;
+
+class W5100Model {
+public:
+    uint32_t spiBytes    = 0;
+    uint32_t delivered   = 0;
+    uint32_t overflowed  = 0;  // no room left in the socket's RX buffer
+    uint32_t unopened    = 0;  // no socket open on the port
+    uint32_t sent        = 0;  // UDP SENDs (ArtPollReply)
+    int8_t artnetSocket  = -1;
+
+    W5100Model() {
+        reset();
+    }
+
+    void select(bool selected) {
+        if (selected && !this->selected)
+            pos = 0;
+        this->selected = selected;
+    }
+
+    // One byte in from MOSI, the byte to shift out on MISO in return. A
+    // W5100 frame is op, address high, address low, data; anything else
+    // (the library probing for a W5200/W5500 first) is ignored until the
+    // next chip select.
+    uint8_t transfer(uint8_t in) {
+        spiBytes++;
+        if (!selected)
+            return 0;
+
+        uint8_t out = pos < 3 ? pos : 0;
+        if (pos < 4)
+            frame[pos] = in;
+        if (pos == 0 && in != 0xF0 && in != 0x0F)
+            pos = 4;  // not a W5100 frame
+        else if (pos == 3) {
+            uint16_t addr = (frame[1] << 8) | frame[2];
+            if (frame[0] == 0xF0)
+                write(addr, in);
+            else
+                out = read(addr);
+            pos = 0;  // the library sends one frame per select, but the chip takes more
+            return out;
+        }
+        if (pos < 4)
+            pos++;
+        return out;
+    }
+
+    // Queue a UDP packet on whichever socket is open on `port`, with the
+    // 8 byte header (peer IP, peer port, length) the W5100 puts before it.
+    void deliver(const std::vector<uint8_t>& payload, uint16_t port) {
+        for (uint8_t s = 0; s < 4; s++) {
+            if (mem[sock(s, Sn_SR)] != SOCK_UDP || get16(sock(s, Sn_PORT)) != port)
+                continue;
+
+            uint16_t rsr  = get16(sock(s, Sn_RX_RSR));
+            uint16_t need = 8 + payload.size();
+            if (rsr + need > rxSize(s)) {
+                overflowed++;
+                return;
+            }
+            const uint8_t header[8] = {192, 168, 1, 100, ARTNET_PORT >> 8, ARTNET_PORT & 0xFF,
+                                       (uint8_t)(payload.size() >> 8), (uint8_t)payload.size()};
+            for (uint8_t i = 0; i < 8; i++)
+                rxPut(s, header[i]);
+            for (uint8_t b : payload)
+                rxPut(s, b);
+            set16(sock(s, Sn_RX_RSR), rsr + need);
+            mem[sock(s, Sn_IR)] |= IR_RECV;
+            delivered++;
+            return;
+        }
+        unopened++;
+    }
+
+private:
+    uint8_t mem[MEM_SIZE];
+    uint8_t frame[4];
+    uint8_t pos   = 0;
+    bool selected = false;
+    uint16_t rxWr[4];  // the chip's own write pointer, not visible to the MCU
+
+    static uint16_t sock(uint8_t s, uint8_t reg) {
+        return SOCK_BASE + s * SOCK_SIZE + reg;
+    }
+
+    uint16_t get16(uint16_t addr) const {
+        return (mem[addr] << 8) | mem[addr + 1];
+    }
+
+    void set16(uint16_t addr, uint16_t v) {
+        mem[addr]     = v >> 8;
+        mem[addr + 1] = v & 0xFF;
+    }
+
+    // RMSR/TMSR give each socket 1, 2, 4 or 8K, back to back in socket order
+    uint16_t bufSize(uint8_t msr, uint8_t s) const {
+        return 1024 << ((msr >> (s * 2)) & 3);
+    }
+
+    uint16_t bufBase(uint8_t msr, uint16_t base, uint8_t s) const {
+        for (uint8_t i = 0; i < s; i++)
+            base += bufSize(msr, i);
+        return base;
+    }
+
+    uint16_t rxSize(uint8_t s) const {
+        return bufSize(mem[RMSR], s);
+    }
+
+    uint16_t txSize(uint8_t s) const {
+        return bufSize(mem[TMSR], s);
+    }
+
+    void rxPut(uint8_t s, uint8_t b) {
+        uint16_t addr = bufBase(mem[RMSR], RX_BASE, s) + (rxWr[s] & (rxSize(s) - 1));
+        if (addr < MEM_SIZE)
+            mem[addr] = b;
+        rxWr[s]++;
+    }
+
+    void reset() {
+        memset(mem, 0, sizeof(mem));
+        memset(rxWr, 0, sizeof(rxWr));
+        mem[RMSR] = 0x55;
+        mem[TMSR] = 0x55;
+        for (uint8_t s = 0; s < 4; s++)
+            set16(sock(s, Sn_TX_FSR), txSize(s));
+    }
+
+    uint8_t read(uint16_t addr) {
+        return addr < MEM_SIZE ? mem[addr] : 0;
+    }
+
+    void write(uint16_t addr, uint8_t v) {
+        if (addr >= MEM_SIZE)
+            return;
+        if (addr == MR && (v & 0x80)) {
+            reset();  // MR reads 0 again once the reset is done
+            return;
+        }
+        if (addr >= SOCK_BASE && addr < SOCK_BASE + 4 * SOCK_SIZE) {
+            uint8_t s   = (addr - SOCK_BASE) / SOCK_SIZE;
+            uint8_t reg = (addr - SOCK_BASE) % SOCK_SIZE;
+            if (reg == Sn_CR) {
+                command(s, v);  // reads back 0: done at once
+                return;
+            }
+            if (reg == Sn_IR) {
+                mem[addr] &= ~v;  // write 1 to clear
+                return;
+            }
+        }
+        mem[addr] = v;
+    }
+
+    void command(uint8_t s, uint8_t cmd) {
+        switch (cmd) {
+            case CMD_OPEN:
+                mem[sock(s, Sn_SR)] = (mem[sock(s, Sn_MR)] & 0x0F) == 0x02 ? SOCK_UDP : 0x13;
+                rxWr[s]             = 0;
+                set16(sock(s, Sn_RX_RD), 0);
+                set16(sock(s, Sn_RX_RSR), 0);
+                set16(sock(s, Sn_TX_RD), 0);
+                set16(sock(s, Sn_TX_WR), 0);
+                set16(sock(s, Sn_TX_FSR), txSize(s));
+                if (mem[sock(s, Sn_SR)] == SOCK_UDP && get16(sock(s, Sn_PORT)) == ARTNET_PORT)
+                    artnetSocket = s;
+                break;
+            case CMD_CLOSE: mem[sock(s, Sn_SR)] = 0; break;
+            case CMD_SEND:
+                set16(sock(s, Sn_TX_RD), get16(sock(s, Sn_TX_WR)));
+                set16(sock(s, Sn_TX_FSR), txSize(s));
+                mem[sock(s, Sn_IR)] |= IR_SEND;
+                sent++;
+                break;
+            case CMD_RECV: set16(sock(s, Sn_RX_RSR), rxWr[s] - get16(sock(s, Sn_RX_RD))); break;
+        }
+    }
+};
+
+/***************************************************/
+/**                  simulation                   **/
+/***************************************************/
+
+static W5100Model w5100;
+static avr_irq_t* spiIn;
+
+static void spi_out_hook(avr_irq_t* irq, uint32_t value, void* param) {
+    avr_raise_irq(spiIn, w5100.transfer(value));
+}
+
+// Ethernet shield SS is pin 10, PB4 on the Mega
+static void ss_hook(avr_irq_t* irq, uint32_t value, void* param) {
+    w5100.select(!value);
+}
+
+// Flash byte address -> index into probes[], for a lookup per instruction
+static std::vector<int8_t> probeAt;
+
+static bool load_symbols(const char* path) {
+    if (elf_version(EV_CURRENT) == EV_NONE)
+        return false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    Elf* elf = elf_begin(fd, ELF_C_READ, nullptr);
+
+    Elf_Scn* scn = nullptr;
+    while (elf && (scn = elf_nextscn(elf, scn))) {
+        GElf_Shdr shdr;
+        if (!gelf_getshdr(scn, &shdr) || shdr.sh_type != SHT_SYMTAB)
+            continue;
+
+        Elf_Data* data = elf_getdata(scn, nullptr);
+        size_t count   = shdr.sh_size / shdr.sh_entsize;
+        for (size_t i = 0; i < count; i++) {
+            GElf_Sym sym;
+            gelf_getsym(data, i, &sym);
+            if (GELF_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_value / 2 >= probeAt.size())
+                continue;
+
+            const char* raw = elf_strptr(elf, shdr.sh_link, sym.st_name);
+            int status;
+            char* demangled = abi::__cxa_demangle(raw, nullptr, nullptr, &status);
+            std::string name = status == 0 ? demangled : raw;
+            free(demangled);
+
+            for (uint8_t p = 0; p < NUM_PROBES; p++) {
+                if (probe_matches(probes[p], name)) {
+                    probeAt[sym.st_value / 2] = p;
+                    probes[p].found           = true;
+                }
+            }
+        }
+    }
+    if (elf)
+        elf_end(elf);
+    close(fd);
+    return true;
+}
+
+static bool load_recording(const char* path, std::vector<RecordedPacket>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    uint8_t hdr[6];
+    while (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr)) {
+        RecordedPacket p;
+        p.at_us     = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | ((uint32_t)hdr[3] << 24);
+        uint16_t sz = hdr[4] | (hdr[5] << 8);
+        p.data.resize(sz);
+        if (fread(p.data.data(), 1, sz, f) != sz)
+            break;
+        out.push_back(std::move(p));
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+// ArtDmx frames of full universes, each universe a different level
+static void synthesize(std::vector<RecordedPacket>& out) {
+    uint32_t frames = (uint32_t)(config.fps * config.seconds);
+    uint32_t period = (uint32_t)(1000000.0f / config.fps);
+    uint8_t sequence = 0;
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        sequence = sequence == 0xFF ? 1 : sequence + 1;
+        for (uint8_t rel = 0; rel < config.universes; rel++) {
+            uint16_t universe = config.start + rel;
+            RecordedPacket p;
+            p.at_us = frame * period;
+            p.data.assign(18 + 510, (uint8_t)(frame + rel));
+            memcpy(p.data.data(), "Art-Net", 8);
+            p.data[8]  = 0x00;  // OpDmx, little endian
+            p.data[9]  = 0x50;
+            p.data[10] = 0;     // protocol version 14
+            p.data[11] = 14;
+            p.data[12] = sequence;
+            p.data[13] = 0;
+            p.data[14] = universe & 0xFF;
+            p.data[15] = (universe >> 8) & 0x7F;
+            p.data[16] = 510 >> 8;
+            p.data[17] = 510 & 0xFF;
+            out.push_back(std::move(p));
+        }
+    }
+}
+
+struct Active {
+    uint8_t probe;
+    uint16_t sp;
+    avr_cycle_count_t start;
+};
+
+static uint16_t stack_pointer(avr_t* avr) {
+    return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+static void usage(const char* argv0) {
+    printf(
+        "usage: %s [options]\n"
+        "  -e, --elf FILE         firmware to run (default %s)\n"
+        "  -u, --universes N      universes per synthetic frame (default 2)\n"
+        "      --start U          first universe (default 0)\n"
+        "  -f, --fps F            synthetic frame rate (default 40)\n"
+        "  -s, --seconds S        synthetic run length (default 2)\n"
+        "  -r, --replay FILE      feed an artnet_bench recording instead\n",
+        argv0,
+        config.elf);
+}
+
+static bool parse_args(int argc, char** argv) {
+    static const option options[] = {
+        {"elf", required_argument, nullptr, 'e'},    {"universes", required_argument, nullptr, 'u'},
+        {"start", required_argument, nullptr, 'U'},  {"fps", required_argument, nullptr, 'f'},
+        {"seconds", required_argument, nullptr, 's'}, {"replay", required_argument, nullptr, 'r'},
+        {"help", no_argument, nullptr, 'h'},          {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "e:u:f:s:r:h", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'e': config.elf = optarg; break;
+            case 'u': config.universes = (uint8_t)atoi(optarg); break;
+            case 'U': config.start = (uint16_t)atoi(optarg); break;
+            case 'f': config.fps = atof(optarg); break;
+            case 's': config.seconds = atof(optarg); break;
+            case 'r': config.replay = optarg; break;
+            default: return false;
+        }
+    }
+    return config.universes > 0 && config.fps > 0 && config.seconds > 0;
+}
+
+// Returns false if a function in the ELF was never called although packets
+// arrived: the probe is timing code the firmware no longer runs.
+static bool report(avr_cycle_count_t boot, avr_cycle_count_t cycles) {
+    bool ok = true;
+    printf("boot                %.3f s to the Art-Net socket\n", (double)boot / F_CPU_HZ);
+    printf("simulated           %.3f s after boot\n", (double)cycles / F_CPU_HZ);
+    printf("packets delivered   %u (%u RX overflow, %u no socket)\n", w5100.delivered, w5100.overflowed,
+           w5100.unopened);
+    printf("packets sent        %u\n", w5100.sent);
+    printf("SPI bytes           %u\n", w5100.spiBytes);
+    printf("\n%-20s %8s %10s %10s %10s %10s\n", "cycles", "calls", "min", "mean", "max", "mean us");
+    for (const Probe& p : probes) {
+        if (!p.found) {
+            printf("%-20s  not in the ELF (inlined?)\n", p.label);
+            continue;
+        }
+        if (!p.calls) {
+            printf("%-20s %8u\n", p.label, 0u);
+            if (w5100.delivered) {
+                fprintf(stderr, "%s was never called, with %u packets delivered\n", p.label, w5100.delivered);
+                ok = false;
+            }
+            continue;
+        }
+        double mean = (double)p.total / p.calls;
+        printf("%-20s %8u %10llu %10.0f %10llu %10.1f\n", p.label, p.calls, (unsigned long long)p.min, mean,
+               (unsigned long long)p.max, mean * 1e6 / F_CPU_HZ);
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<RecordedPacket> packets;
+    if (config.replay) {
+        if (!load_recording(config.replay, packets)) {
+            fprintf(stderr, "cannot load recording %s\n", config.replay);
+            return 1;
+        }
+    }
+    else
+        synthesize(packets);
+    if (packets.empty()) {
+        fprintf(stderr, "no packets to send: --fps times --seconds is under one frame\n");
+        return 2;
+    }
+
+    elf_firmware_t fw;
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(config.elf, &fw) != 0) {
+        fprintf(stderr, "cannot load firmware %s\n", config.elf);
+        return 1;
+    }
+    strcpy(fw.mmcu, "atmega2560");
+    fw.frequency = F_CPU_HZ;
+
+    avr_t* avr = avr_make_mcu_by_name(fw.mmcu);
+    if (!avr) {
+        fprintf(stderr, "simavr has no %s\n", fw.mmcu);
+        return 1;
+    }
+    avr_init(avr);
+    avr_load_firmware(avr, &fw);
+
+    probeAt.assign((avr->flashend + 1) / 2, -1);
+    if (!load_symbols(config.elf)) {
+        fprintf(stderr, "cannot read symbols from %s\n", config.elf);
+        return 1;
+    }
+
+    spiIn = avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), spi_out_hook, nullptr);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 4), ss_hook, nullptr);
+
+    // Boot until the firmware opens its Art-Net socket; only what happens
+    // after that is timed.
+    avr_cycle_count_t bootLimit = (avr_cycle_count_t)(config.boot_seconds * F_CPU_HZ);
+    int state                   = cpu_Running;
+    while (w5100.artnetSocket < 0 && avr->cycle < bootLimit) {
+        state = avr_run(avr);
+        if (state == cpu_Done || state == cpu_Crashed)
+            break;
+    }
+    if (w5100.artnetSocket < 0) {
+        fprintf(stderr, "firmware never opened UDP port %u (built with DHCP=0 and TEST_MODE=0?)\n", ARTNET_PORT);
+        return 1;
+    }
+
+    avr_cycle_count_t boot = avr->cycle;
+    avr_cycle_count_t end  = boot + (avr_cycle_count_t)(packets.back().at_us + 100000) * (F_CPU_HZ / 1000000);
+    std::vector<Active> active;
+    size_t next = 0;
+
+    while (avr->cycle < end) {
+        while (next < packets.size() &&
+               avr->cycle >= boot + (avr_cycle_count_t)packets[next].at_us * (F_CPU_HZ / 1000000)) {
+            w5100.deliver(packets[next].data, ARTNET_PORT);
+            next++;
+        }
+
+        state = avr_run(avr);
+        if (state == cpu_Done || state == cpu_Crashed) {
+            fprintf(stderr, "firmware stopped (state %d) at pc 0x%05x\n", state, avr->pc);
+            break;
+        }
+
+        // A timed function has returned once SP is back above where it was
+        // on entry (the return address popped)
+        uint16_t sp = stack_pointer(avr);
+        while (!active.empty() && sp > active.back().sp) {
+            Probe& p          = probes[active.back().probe];
+            uint64_t cycles   = avr->cycle - active.back().start;
+            p.calls++;
+            p.total += cycles;
+            p.min = std::min(p.min, cycles);
+            p.max = std::max(p.max, cycles);
+            active.pop_back();
+        }
+
+        // Entry: the first instruction is about to run. A loop that jumps
+        // back to it is not a new call.
+        if (avr->pc / 2 < probeAt.size() && probeAt[avr->pc / 2] >= 0) {
+            uint8_t p = probeAt[avr->pc / 2];
+            if (active.empty() || active.back().probe != p || active.back().sp != sp)
+                active.push_back({p, sp, avr->cycle});
+        }
+    }
+
+    return report(boot, avr->cycle - boot) ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+// Trace decoder
+// by Miles Punch
+
+// All Rights Reserved 2025
+// Licensed under the GNU GPL License.
+
+// Turns the firmware's trace dumps (built with -DTRACE=1, see lib/Trace)
+// into a timeline of the hot path, and a per-frame breakdown of where the
+// microseconds between one show() and the next went. Reads a capture of
+// the serial output, which may hold other text and several dumps, or asks
+// the board for a dump itself over its serial port.
+//
+// Time in a step is counted as its own, less the steps nested in it: a
+// socketRecv() inside parse() counts as recv, not parse. What isn't in any
+// step is loop(): polling, frame timeouts, DHCP, telemetry.
+
+#include <Trace.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+static const uint8_t DUMP_REQUEST = 'T';  // TRACE_DUMP_REQUEST in main.h
+
+struct DecodeConfig {
+    const char* input = nullptr;  // capture file, "-" for stdin
+    const char* port  = nullptr;  // or a serial port to request a dump on
+    int baud          = 115200;
+    bool summary      = false;  // frames only, no timeline
+};
+static DecodeConfig config;
+
+struct Event {
+    uint32_t time;
+    uint8_t id;
+    uint8_t arg;
+};
+
+enum Step { STEP_LOOP, STEP_PARSE, STEP_RECV, STEP_CALLBACK, STEP_SHOW, STEPS };
+static const char* const STEP_NAMES[STEPS] = {"loop", "parse", "recv", "callback", "show"};
+
+static Step step_of(uint8_t id) {
+    switch (id & ~TRACE_END) {
+        case TRACE_PARSE: return STEP_PARSE;
+        case TRACE_RECV: return STEP_RECV;
+        case TRACE_CALLBACK: return STEP_CALLBACK;
+        case TRACE_SHOW: return STEP_SHOW;
+        default: return STEP_LOOP;
+    }
+}
+
+static const char* op_name(uint8_t high) {
+    switch (high) {
+        case 0x00: return "not Art-Net";
+        case 0x20: return "ArtPoll";
+        case 0x21: return "ArtPollReply";
+        case 0x23: return "ArtDiagData";
+        case 0x50: return "ArtDmx";
+        case 0x51: return "ArtNzs";
+        case 0x52: return "ArtSync";
+        case 0x99: return "ArtTrigger";
+        default: return "other";
+    }
+}
+
+static std::string describe(const Event& e) {
+    char text[48];
+    bool end = e.id & TRACE_END;
+    switch (e.id & ~TRACE_END) {
+        case TRACE_PARSE:
+            snprintf(text, sizeof(text), end ? "parse %s" : "parse", op_name(e.arg));
+            break;
+        case TRACE_RECV: snprintf(text, sizeof(text), "recv socket %u", e.arg); break;
+        case TRACE_CALLBACK: snprintf(text, sizeof(text), "callback universe +%u", e.arg); break;
+        case TRACE_SHOW: snprintf(text, sizeof(text), "show universes 0x%02X", e.arg); break;
+        case TRACE_DUMP: snprintf(text, sizeof(text), "(previous dump written out)"); break;
+        default: snprintf(text, sizeof(text), "event 0x%02X arg %u", e.id, e.arg); break;
+    }
+    return text;
+}
+
+// Pull every complete dump out of a byte stream
+static std::vector<std::vector<Event>> find_dumps(const std::vector<uint8_t>& data) {
+    std::vector<std::vector<Event>> dumps;
+    size_t i = 0;
+    while (i + TRACE_MAGIC_SIZE + 2 <= data.size()) {
+        if (memcmp(&data[i], TRACE_MAGIC, TRACE_MAGIC_SIZE)) {
+            i++;
+            continue;
+        }
+        size_t count = data[i + TRACE_MAGIC_SIZE] | (data[i + TRACE_MAGIC_SIZE + 1] << 8);
+        size_t start = i + TRACE_MAGIC_SIZE + 2;
+        if (count > 256 || start + count * TRACE_RECORD_SIZE > data.size()) {
+            i++;  // not a dump after all, or cut off
+            continue;
+        }
+        std::vector<Event> events(count);
+        for (size_t n = 0; n < count; n++) {
+            const uint8_t* r = &data[start + n * TRACE_RECORD_SIZE];
+            events[n]        = {(uint32_t)(r[0] | r[1] << 8 | r[2] << 16 | (uint32_t)r[3] << 24), r[4], r[5]};
+        }
+        dumps.push_back(events);
+        i = start + count * TRACE_RECORD_SIZE;
+    }
+    return dumps;
+}
+
+struct Frame {
+    uint32_t total;
+    uint32_t self[STEPS];
+    uint16_t packets;
+};
+
+static void decode(const std::vector<Event>& events, int number) {
+    struct Open {
+        uint8_t id;
+        uint32_t begin;
+        uint32_t nested;
+    };
+    std::vector<Open> open;
+    std::vector<Frame> frames;
+    Frame frame       = {};
+    bool inFrame      = false;  // a show has been seen, so frame timing is complete
+    uint32_t frameAt  = 0;      // end of the last show
+    uint32_t lastTime = events.empty() ? 0 : events[0].time;
+
+    printf("dump %d: %zu events over %u us\n", number, events.size(),
+           events.empty() ? 0 : events.back().time - events[0].time);
+    if (!config.summary)
+        printf("\n%10s %8s %8s  %s\n", "us", "+us", "took", "event");
+
+    for (const Event& e : events) {
+        uint32_t t    = e.time - events[0].time;
+        char took[16] = "";
+        size_t depth  = open.size();  // steps this event is nested in
+
+        if (e.id & TRACE_END) {
+            // An END without its BEGIN began before the oldest event kept
+            if (!open.empty() && open.back().id == (e.id & ~TRACE_END)) {
+                uint32_t d = e.time - open.back().begin;
+                snprintf(took, sizeof(took), "%u", d);
+                frame.self[step_of(e.id)] += d - open.back().nested;
+                open.pop_back();
+                if (!open.empty())
+                    open.back().nested += d;
+                depth--;
+            }
+            if ((e.id & ~TRACE_END) == TRACE_PARSE && (e.arg == 0x50 || e.arg == 0x51))
+                frame.packets++;
+        }
+        else if (e.id == TRACE_DUMP) {
+            inFrame = false;  // the time spent dumping isn't a frame's
+        }
+        else {
+            open.push_back({e.id, e.time, 0});
+        }
+
+        if (!config.summary)
+            printf("%10u %8u %8s  %*s%s%s\n", t, e.time - lastTime, took, (int)depth * 2, "",
+                   e.id & TRACE_END ? "end " : "", describe(e).c_str());
+        lastTime = e.time;
+
+        if (e.id == (TRACE_SHOW | TRACE_END) && open.empty()) {
+            if (inFrame) {
+                frame.total      = e.time - frameAt;
+                uint32_t stepped = 0;
+                for (int s = STEP_PARSE; s < STEPS; s++)
+                    stepped += frame.self[s];
+                frame.self[STEP_LOOP] = frame.total - stepped;
+                frames.push_back(frame);
+            }
+            frame   = {};
+            frameAt = e.time;
+            inFrame = true;
+        }
+    }
+
+    if (frames.empty()) {
+        printf("\nno complete frame (show to show) in this dump\n\n");
+        return;
+    }
+    printf("\n%-8s %8s %8s", "frame", "us", "packets");
+    for (int s = 0; s < STEPS; s++)
+        printf(" %8s", STEP_NAMES[s]);
+    printf("\n");
+    Frame sum = {};
+    for (size_t n = 0; n < frames.size(); n++) {
+        const Frame& f = frames[n];
+        printf("%-8zu %8u %8u", n + 1, f.total, f.packets);
+        for (int s = 0; s < STEPS; s++)
+            printf(" %8u", f.self[s]);
+        printf("\n");
+        sum.total += f.total;
+        sum.packets += f.packets;
+        for (int s = 0; s < STEPS; s++)
+            sum.self[s] += f.self[s];
+    }
+    double n = frames.size();
+    printf("%-8s %8.0f %8.1f", "mean", sum.total / n, sum.packets / n);
+    for (int s = 0; s < STEPS; s++)
+        printf(" %8.0f", sum.self[s] / n);
+    printf("\n%-8s %8s %8s", "share", "", "");
+    for (int s = 0; s < STEPS; s++)
+        printf(" %7.1f%%", sum.total ? 100.0 * sum.self[s] / sum.total : 0.0);
+    printf("\n\n");
+}
+
+static bool read_stream(FILE* in, std::vector<uint8_t>& data) {
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    return !ferror(in);
+}
+
+static speed_t baud_constant(int baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        default: return 0;
+    }
+}
+
+// Send the dump request, and read until a whole dump is in or the port has
+// been quiet for half a second
+static bool request_dump(std::vector<uint8_t>& data) {
+    int fd = open(config.port, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        return false;
+    termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        close(fd);
+        return false;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, baud_constant(config.baud));
+    cfsetospeed(&tty, baud_constant(config.baud));
+    tty.c_cc[VMIN]  = 0;
+    tty.c_cc[VTIME] = 5;  // tenths of a second
+    tcsetattr(fd, TCSANOW, &tty);
+    tcflush(fd, TCIOFLUSH);
+
+    if (write(fd, &DUMP_REQUEST, 1) != 1) {
+        close(fd);
+        return false;
+    }
+    uint8_t buf[512];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        data.insert(data.end(), buf, buf + n);
+        if (!find_dumps(data).empty())
+            break;
+    }
+    close(fd);
+    return true;
+}
+
+static void usage(const char* argv0) {
+    printf(
+        "usage: %s [options] [FILE]\n"
+        "  FILE                   serial capture holding trace dumps, - for stdin\n"
+        "  -p, --port DEV         ask the board on DEV for a dump instead\n"
+        "  -b, --baud N           baud rate for --port (default 115200)\n"
+        "  -s, --summary          per-frame breakdown only, no timeline\n",
+        argv0);
+}
+
+static bool parse_args(int argc, char** argv) {
+    static const option options[] = {
+        {"port", required_argument, nullptr, 'p'}, {"baud", required_argument, nullptr, 'b'},
+        {"summary", no_argument, nullptr, 's'},    {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:b:sh", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'p': config.port = optarg; break;
+            case 'b': config.baud = atoi(optarg); break;
+            case 's': config.summary = true; break;
+            default: return false;
+        }
+    }
+    if (optind < argc)
+        config.input = argv[optind++];
+    return optind == argc && !config.port != !config.input && baud_constant(config.baud);
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> data;
+    if (config.port) {
+        if (!request_dump(data)) {
+            fprintf(stderr, "cannot talk to %s\n", config.port);
+            return 1;
+        }
+    }
+    else {
+        FILE* in = strcmp(config.input, "-") ? fopen(config.input, "rb") : stdin;
+        if (!in || !read_stream(in, data)) {
+            fprintf(stderr, "cannot read %s\n", config.input);
+            return 1;
+        }
+        if (in != stdin)
+            fclose(in);
+    }
+
+    std::vector<std::vector<Event>> dumps = find_dumps(data);
+    if (dumps.empty()) {
+        fprintf(stderr, "no trace dump found (is the firmware built with -DTRACE=1?)\n");
+        return 1;
+    }
+    for (size_t n = 0; n < dumps.size(); n++)
+        decode(dumps[n], n + 1);
+    return 0;
+}